@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include "analysis.h"
+#include "program.h"
+
+// Local functions
+int step(const Instruction *instruction, const int32_t *operands, int *lengths);
+int uncheckable(int32_t op);
+
+int step(const Instruction *instruction, const int32_t *operands, int *lengths)
+{
+    /* Local function
+    EFFECT: Applies _instruction_, with the operand table _operands_ of its program, to _lengths_, the 
+    length of every live array by slot (0 if the array is not allocated, negated for arrays of bits), 
+    assuming it succeeds. Arrays freed early by the liveness analysis are freed too
+    OUTPUT: 1 if _instruction_ provably succeeds; 2 if it provably succeeds on an array of bits, which
+    the unchecked fast path does not handle; 0 if it fails and thus stops the program */
+
+    int length1 = instruction->slot1 >= 0 ? abs(lengths[instruction->slot1]) : 0;
+    int length2 = instruction->slot2 >= 0 ? abs(lengths[instruction->slot2]) : 0;
+    int bits = (instruction->slot1 >= 0 && lengths[instruction->slot1] < 0)
+               || (instruction->slot2 >= 0 && lengths[instruction->slot2] < 0);
+    int safe = 0;
+
+    switch (instruction->op)
+    {
+        case OP_ASS:
+        case OP_PRA:
+        case OP_CNT:
+        case OP_SRT:
+        case OP_SCN:
+        case OP_SCX:
+            safe = length1 > 0;
+            break;
+        case OP_INC:
+        case OP_DEC:
+        case OP_PRI:
+            safe = instruction->value >= 0 && instruction->value < length1;
+            break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            safe = length1 > 0 && length2 > 0;
+            break;
+        case OP_AND:
+        case OP_XOR:
+            safe = length1 > 0 && length1 == length2;
+            break;
+        case OP_MAL:
+            // Allocation fails for live arrays and invalid lengths
+            safe = !length1 && instruction->value > 0;
+            if (safe)
+            {
+                lengths[instruction->slot1] = instruction->value;
+            }
+            break;
+        case OP_BIT:
+            safe = !length1 && instruction->value > 0;
+            if (safe)
+            {
+                lengths[instruction->slot1] = -instruction->value;
+            }
+            break;
+        case OP_FRE:
+            safe = length1 > 0;
+            lengths[instruction->slot1] = 0;
+            break;
+        case OP_REA:
+            // Resizing fails for arrays that are not live and invalid lengths; bit arrays stay bit arrays
+            safe = length1 > 0 && instruction->value > 0;
+            if (safe)
+            {
+                lengths[instruction->slot1] = lengths[instruction->slot1] < 0 ? -instruction->value : instruction->value;
+            }
+            break;
+        case OP_FIL:
+        {
+            const int32_t *range = operands + instruction->value;
+            safe = range[2] < 0 ? length1 > 0
+                                : range[1] >= 0 && range[2] > 0 && range[2] <= length1 - range[1];
+            break;
+        }
+        case OP_CPY:
+        {
+            const int32_t *range = operands + instruction->value;
+            safe = range[2] < 0 ? length1 > 0 && length2 > 0 && length2 <= length1
+                                : range[0] >= 0 && range[1] >= 0 && range[2] > 0 && range[2] <= length1 - range[0]
+                                  && range[2] <= length2 - range[1];
+            break;
+        }
+    }
+
+    if (safe && (instruction->flags & INS_FREE1))
+    {
+        lengths[instruction->slot1] = 0;
+    }
+    if (safe && (instruction->flags & INS_FREE2))
+    {
+        lengths[instruction->slot2] = 0;
+    }
+
+    return safe ? 1 + bits : 0;
+}
+
+
+int uncheckable(int32_t op)
+{
+    /* Local function
+    EFFECT: Checks whether instructions with opcode _op_ have an unchecked fast path in the executor; 
+    the others always run through the checked functions, so flagging them would be meaningless
+    OUTPUT: 1 if they have one; 0 otherwise */
+
+    switch (op)
+    {
+        case OP_ASS: case OP_INC: case OP_DEC: case OP_PRI: case OP_ADD: case OP_SUB: case OP_MUL:
+        case OP_AND: case OP_XOR: case OP_PRA:
+            return 1;
+    }
+
+    return 0;
+}
+
+
+int analyseBounds(Program *program)
+{
+    int *lengths = calloc(program->nameCount ? program->nameCount : 1, sizeof(int));
+    if (!lengths)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < program->length; i++)
+    {
+        program->code[i].flags &= ~INS_UNCHECKED;
+    }
+
+    int marked = 0;
+    for (int i = 0; i < program->length; i++)
+    {
+        Instruction *instruction = &program->code[i];
+
+        // The checked path reports the error and stops the program, nothing after it executes
+        int safe = step(instruction, program->operands, lengths);
+        if (!safe)
+        {
+            break;
+        }
+
+        if (safe == 1 && uncheckable(instruction->op))
+        {
+            instruction->flags |= INS_UNCHECKED;
+            marked++;
+        }
+    }
+
+    free(lengths);
+
+    return marked;
+}
+
+
+int verifyBounds(const Program *program)
+{
+    int *lengths = calloc(program->nameCount ? program->nameCount : 1, sizeof(int));
+    if (!lengths)
+    {
+        return -1;
+    }
+
+    // Instructions after the first failing one never execute, so the analysis never flags them; flags there
+    // only show that the program was tampered with
+    int error = 0;
+    int failed = 0;
+    for (int i = 0; i < program->length && !error; i++)
+    {
+        const Instruction *instruction = &program->code[i];
+        if (failed)
+        {
+            error = (instruction->flags & (INS_UNCHECKED | INS_FREE1 | INS_FREE2)) != 0;
+            continue;
+        }
+
+        int safe = step(instruction, program->operands, lengths);
+        if (safe != 1)
+        {
+            error = (instruction->flags & INS_UNCHECKED) != 0;
+        }
+        failed = !safe;
+    }
+
+    free(lengths);
+
+    return error;
+}
+
+
+int analyseLiveness(Program *program)
+{
+    int count = program->nameCount ? program->nameCount : 1;
+
+    // Length of every live array by slot, and the last instruction that referred to it
+    int *lengths = calloc(count, sizeof(int));
+    int *lastUse = malloc(count * sizeof(int));
+    if (!lengths || !lastUse)
+    {
+        free(lengths);
+        free(lastUse);
+        return -1;
+    }
+
+    for (int i = 0; i < program->length; i++)
+    {
+        program->code[i].flags &= ~(INS_FREE1 | INS_FREE2);
+    }
+
+    int i;
+    for (i = 0; i < program->length; i++)
+    {
+        Instruction *instruction = &program->code[i];
+        int slot1 = instruction->slot1;
+        int slot2 = instruction->slot2;
+        int fails = !step(instruction, program->operands, lengths);
+
+        // The failing instruction reports its error with the arrays still in place; nothing runs after it
+        if (fails)
+        {
+            break;
+        }
+
+        if (instruction->op == OP_FRE)
+        {
+            continue;
+        }
+
+        lastUse[slot1] = i;
+        if (slot2 >= 0)
+        {
+            lastUse[slot2] = i;
+        }
+    }
+
+    // A failing reference to a live array is a use as well
+    if (i < program->length && program->code[i].op != OP_RAW)
+    {
+        Instruction *instruction = &program->code[i];
+        if (instruction->slot1 >= 0 && lengths[instruction->slot1])
+        {
+            lastUse[instruction->slot1] = i;
+        }
+        if (instruction->slot2 >= 0 && lengths[instruction->slot2])
+        {
+            lastUse[instruction->slot2] = i;
+        }
+    }
+
+    int freed = 0;
+    for (int slot = 0; slot < program->nameCount; slot++)
+    {
+        if (!lengths[slot] || (i < program->length && lastUse[slot] == i))
+        {
+            continue;
+        }
+
+        Instruction *instruction = &program->code[lastUse[slot]];
+        instruction->flags |= instruction->slot1 == slot ? INS_FREE1 : INS_FREE2;
+        freed++;
+    }
+
+    free(lengths);
+    free(lastUse);
+
+    return freed;
+}
@@ -0,0 +1,30 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "program.h"
+
+/* EFFECT: Statically tracks which arrays are live and their lengths along _program_. Programs are 
+straight-line and stop at the first error, so when an instruction executes all instructions before it
+have succeeded and the state of every array is known exactly. Every Ass, Inc, Dec, Pri, Add, Sub, Mul,
+And, Xor, and Pra instruction that provably accesses live arrays within their range (and, for And and
+Xor, arrays of equal length) is flagged INS_UNCHECKED. All other instructions keep the full checks
+OUTPUT: The number of instructions flagged INS_UNCHECKED; -1 if allocating memory failed */
+int analyseBounds(Program *program);
+
+/* EFFECT: Checks that every instruction of _program_ flagged INS_UNCHECKED that can execute is proven 
+safe, taking arrays freed early into account, and that no instruction after the first one that fails is
+flagged at all. Used for programs whose flags were not computed by this process, such as precompiled 
+programs, whose identifiers must all differ
+OUTPUT: 0 if the flags are sound; 1 if an instruction is flagged INS_UNCHECKED without being safe, or 
+an instruction that can not execute is flagged; -1 if allocating memory failed */
+int verifyBounds(const Program *program);
+
+/* EFFECT: Finds the last instruction of _program_ that refers to each allocated array and flags it 
+INS_FREE1 or INS_FREE2, so the executor frees the array right after it instead of at the end of the 
+program. Arrays freed explicitly by Fre are left alone. Any later reference to the identifier, even 
+one that fails or reallocates it, counts as a use, so printed output and error messages do not change; 
+only allocations that would have run out of memory may now succeed
+OUTPUT: The number of arrays freed early; -1 if allocating memory failed */
+int analyseLiveness(Program *program);
+
+#endif
@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "interpreter.h"
+#include "output.h"
+
+/* A program of the batch and its captured output */
+typedef struct Job
+{
+    char *path;
+    char *out;
+    size_t outSize;
+    char *err;
+    size_t errSize;
+    int failed;
+    int done;
+} Job;
+
+/* State shared by the workers of a batch */
+typedef struct Batch
+{
+    Job *jobs;
+    int count;
+    atomic_int next;                // next job to hand out
+    int (*runFile)(FILE *file);
+    pthread_mutex_t lock;           // protects _done_ of the jobs
+    pthread_cond_t finished;        // signalled whenever a job is done
+} Batch;
+
+// Local functions
+int comparePaths(const void *a, const void *b);
+int appendPath(Job **jobs, int *count, int *capacity, const char *path);
+int listDirectory(const char *directory, Job **jobs, int *count);
+int listFile(const char *list, Job **jobs, int *count);
+void runJob(Batch *batch, Job *job);
+void *worker(void *argument);
+int writeOutput(const Job *job, const char *outDir);
+
+int comparePaths(const void *a, const void *b)
+{
+    return strcmp(((const Job *) a)->path, ((const Job *) b)->path);
+}
+
+
+int appendPath(Job **jobs, int *count, int *capacity, const char *path)
+{
+    /* Local function
+    EFFECT: Appends a job for the program at _path_ to _jobs_
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+
+    if (*count == *capacity)
+    {
+        int newCapacity = *capacity ? *capacity * 2 : 64;
+        Job *larger = realloc(*jobs, newCapacity * sizeof(Job));
+        if (!larger)
+        {
+            return 1;
+        }
+        *jobs = larger;
+        *capacity = newCapacity;
+    }
+
+    Job *job = &(*jobs)[*count];
+    memset(job, 0, sizeof(Job));
+    job->path = strdup(path);
+    if (!job->path)
+    {
+        return 1;
+    }
+
+    (*count)++;
+    return 0;
+}
+
+
+int listDirectory(const char *directory, Job **jobs, int *count)
+{
+    /* Local function
+    EFFECT: Creates a job for every regular file in _directory_, sorted by name
+    OUTPUT: 0 upon successful execution of the function; 1 if reading the directory failed */
+
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        return 1;
+    }
+
+    int capacity = 0;
+    int error = 0;
+    struct dirent *entry;
+    while (!error && (entry = readdir(dir)))
+    {
+        size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+        char *path = malloc(length);
+        if (!path)
+        {
+            error = 1;
+            break;
+        }
+        snprintf(path, length, "%s/%s", directory, entry->d_name);
+
+        struct stat info;
+        if (!stat(path, &info) && S_ISREG(info.st_mode))
+        {
+            error = appendPath(jobs, count, &capacity, path);
+        }
+        free(path);
+    }
+    closedir(dir);
+
+    if (!error && *count)
+    {
+        qsort(*jobs, *count, sizeof(Job), comparePaths);
+    }
+
+    return error;
+}
+
+
+int listFile(const char *list, Job **jobs, int *count)
+{
+    /* Local function
+    EFFECT: Creates a job for every non-empty line of the file _list_
+    OUTPUT: 0 upon successful execution of the function; 1 if reading the file failed */
+
+    FILE *file = fopen(list, "r");
+    if (!file)
+    {
+        return 1;
+    }
+
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t length;
+    int capacity = 0;
+    int error = 0;
+    while (!error && (length = getline(&line, &lineCapacity, file)) >= 0)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+        {
+            line[--length] = '\0';
+        }
+
+        if (length > 0)
+        {
+            error = appendPath(jobs, count, &capacity, line);
+        }
+    }
+    free(line);
+    fclose(file);
+
+    return error;
+}
+
+
+void runJob(Batch *batch, Job *job)
+{
+    /* Local function
+    EFFECT: Runs the program of _job_ in the context of the calling thread, capturing its output */
+
+    FILE *out = open_memstream(&job->out, &job->outSize);
+    FILE *err = open_memstream(&job->err, &job->errSize);
+    if (!out || !err)
+    {
+        if (out)
+        {
+            fclose(out);
+        }
+        if (err)
+        {
+            fclose(err);
+        }
+        job->failed = 1;
+        return;
+    }
+
+    setStreams(out, err);
+
+    FILE *file = fopen(job->path, "r");
+    if (!file)
+    {
+        fprintf(err, "Error: opening file failed\n");
+        job->failed = 1;
+    }
+    else
+    {
+        job->failed = batch->runFile(file) != 0;
+    }
+
+    // Leave a clean context for the next program
+    if (resetProgram())
+    {
+        job->failed = 1;
+    }
+
+    setStreams(NULL, NULL);
+    fclose(out);
+    fclose(err);
+}
+
+
+void *worker(void *argument)
+{
+    /* Local function
+    EFFECT: Runs jobs of the batch _argument_ until none are left */
+
+    Batch *batch = argument;
+
+    // Without a context the jobs still have to be marked done, as failed
+    int ready = !initializeProgram();
+
+    for (;;)
+    {
+        int i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->count)
+        {
+            break;
+        }
+
+        if (ready)
+        {
+            runJob(batch, &batch->jobs[i]);
+        }
+        else
+        {
+            batch->jobs[i].failed = 1;
+        }
+
+        pthread_mutex_lock(&batch->lock);
+        batch->jobs[i].done = 1;
+        pthread_cond_broadcast(&batch->finished);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    if (ready)
+    {
+        terminateProgram();
+    }
+
+    return NULL;
+}
+
+
+int writeOutput(const Job *job, const char *outDir)
+{
+    /* Local function
+    EFFECT: Writes the captured output of _job_ to its sinks
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+
+    if (!outDir)
+    {
+        fprintf(stdout, "==> %s <==\n", job->path);
+        fwrite(job->out, 1, job->outSize, stdout);
+        if (job->errSize)
+        {
+            fprintf(stderr, "==> %s <==\n", job->path);
+            fwrite(job->err, 1, job->errSize, stderr);
+        }
+        return 0;
+    }
+
+    const char *name = strrchr(job->path, '/');
+    name = name ? name + 1 : job->path;
+
+    const char *suffixes[] = { ".out", ".err" };
+    const char *data[] = { job->out, job->err };
+    size_t sizes[] = { job->outSize, job->errSize };
+    for (int k = 0; k < 2; k++)
+    {
+        size_t length = strlen(outDir) + strlen(name) + 6;
+        char *path = malloc(length);
+        if (!path)
+        {
+            return 1;
+        }
+        snprintf(path, length, "%s/%s%s", outDir, name, suffixes[k]);
+
+        FILE *file = fopen(path, "w");
+        free(path);
+        if (!file)
+        {
+            return 1;
+        }
+
+        size_t written = sizes[k] ? fwrite(data[k], 1, sizes[k], file) : 0;
+        if (fclose(file) || written != sizes[k])
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int runBatch(const char *list, int jobs, const char *outDir, int (*runFile)(FILE *file))
+{
+    Batch batch;
+    batch.jobs = NULL;
+    batch.count = 0;
+    batch.runFile = runFile;
+    atomic_init(&batch.next, 0);
+
+    struct stat info;
+    int error = !stat(list, &info) && S_ISDIR(info.st_mode)
+        ? listDirectory(list, &batch.jobs, &batch.count)
+        : listFile(list, &batch.jobs, &batch.count);
+    if (error)
+    {
+        fprintf(stderr, "Error: reading the batch %s failed\n", list);
+        for (int i = 0; i < batch.count; i++)
+        {
+            free(batch.jobs[i].path);
+        }
+        free(batch.jobs);
+        return -1;
+    }
+
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+    if (jobs > batch.count)
+    {
+        jobs = batch.count ? batch.count : 1;
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.finished, NULL);
+
+    pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+    int started = 0;
+    while (threads && started < jobs && !pthread_create(&threads[started], NULL, worker, &batch))
+    {
+        started++;
+    }
+
+    // Write the output of each program in list order as soon as it and all before it are done
+    int failed = 0;
+    for (int i = 0; started && i < batch.count; i++)
+    {
+        Job *job = &batch.jobs[i];
+
+        pthread_mutex_lock(&batch.lock);
+        while (!job->done)
+        {
+            pthread_cond_wait(&batch.finished, &batch.lock);
+        }
+        pthread_mutex_unlock(&batch.lock);
+
+        if (writeOutput(job, outDir))
+        {
+            fprintf(stderr, "Error: writing the output of %s failed\n", job->path);
+            job->failed = 1;
+        }
+        failed += job->failed;
+
+        free(job->out);
+        free(job->err);
+        job->out = NULL;
+        job->err = NULL;
+    }
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < batch.count; i++)
+    {
+        free(batch.jobs[i].path);
+    }
+    free(batch.jobs);
+    free(threads);
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.finished);
+
+    if (!started)
+    {
+        fprintf(stderr, "Error: starting the batch workers failed\n");
+        return -1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,17 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/* EFFECT: Runs many programs in one process. _list_ is either a directory, of which all regular files 
+are run in alphabetical order, or a file naming one program per line. The programs are distributed over 
+_jobs_ worker threads, each with its own interpreter context that is initialized once and reset between 
+programs. _runFile_ runs one opened program in the calling thread's context and closes it. The output 
+and error messages of every program are captured separately and written in the order of the list: to 
+the standard output and error streams, each preceded by a "==> name <==" header, or, if _outDir_ is not 
+NULL, to the files name.out and name.err in _outDir_
+OUTPUT: The number of programs that failed; -1 if the list could not be read or the workers could not 
+be started */
+int runBatch(const char *list, int jobs, const char *outDir, int (*runFile)(FILE *file));
+
+#endif
@@ -0,0 +1,659 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "functions.h"
+#include "memory.h"
+
+/* Benchmark suite: microbenchmarks of memory.c and the array lookup of functions.c, and end-to-end runs 
+of the interpreter on generated workloads. Results are written as JSON and can be compared against a 
+saved baseline:
+
+    bench [--interpreter PATH] [--arg OPTION]... [--samples N] [--lines N] [--out FILE]
+          [--baseline FILE] [--threshold PERCENT]
+
+Every benchmark is measured as _samples_ samples of a fixed number of operations. Throughput is the total
+number of operations over the total time; the percentiles are of the time per operation in each sample */
+
+#define MAX_RESULTS 64
+#define MAX_ARGS 16
+#define INDEX_COUNT 4096
+
+/* Measurements of one benchmark */
+typedef struct Result
+{
+    char name[64];
+    double opsPerSec;
+    double p50;         // nanoseconds per operation
+    double p90;
+    double p99;
+} Result;
+
+/* Settings of the suite */
+typedef struct Suite
+{
+    const char *interpreter;
+    const char *args[MAX_ARGS];
+    int argCount;
+    int samples;
+    int lines;
+    Result results[MAX_RESULTS];
+    int count;
+} Suite;
+
+/* State of the microbenchmarks */
+typedef struct Micro
+{
+    int indices[INDEX_COUNT];  // random cells or identifiers to access
+    char names[MEM_CELLS][16];
+    int limit;                  // number of valid entries in _indices_
+    volatile int sink;          // keeps results alive
+    MemShared *shared;          // memory of the threads of the shared benchmarks
+    int threads;
+    long operations;            // per thread
+} Micro;
+
+// Local functions
+double now(void);
+int compareDoubles(const void *a, const void *b);
+void record(Suite *suite, const char *name, double *perOp, int samples, double operations, double seconds);
+void measure(Suite *suite, const char *name, void (*run)(Micro *micro, long operations), Micro *micro, long batch);
+void runAllocFree(Micro *micro, long operations);
+void runRead(Micro *micro, long operations);
+void runWrite(Micro *micro, long operations);
+void runLookup(Micro *micro, long operations);
+void *sharedWorker(void *argument);
+void runSharedAllocFree(Micro *micro, long operations);
+void fragment(int holes);
+void benchMemory(Suite *suite, Micro *micro);
+void benchLookup(Suite *suite, Micro *micro);
+void benchShared(Suite *suite, Micro *micro);
+int writeWorkload(const char *kind, int lines, char *path);
+double runInterpreter(const Suite *suite, const char *path);
+void benchWorkloads(Suite *suite);
+int writeResults(const Suite *suite, const char *path);
+int compareBaseline(const Suite *suite, const char *path, double threshold);
+
+double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+void record(Suite *suite, const char *name, double *perOp, int samples, double operations, double seconds)
+{
+    /* EFFECT: Adds the result of benchmark _name_ to _suite_ from the time per operation of every sample
+    and the total number of _operations_ run in _seconds_ */
+
+    if (suite->count == MAX_RESULTS)
+    {
+        return;
+    }
+
+    qsort(perOp, samples, sizeof(double), compareDoubles);
+
+    Result *result = &suite->results[suite->count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->opsPerSec = operations / seconds;
+    result->p50 = perOp[(samples - 1) * 50 / 100];
+    result->p90 = perOp[(samples - 1) * 90 / 100];
+    result->p99 = perOp[(samples - 1) * 99 / 100];
+
+    fprintf(stderr, "%-28s %14.0f ops/s   p50 %10.1f ns   p99 %10.1f ns\n", result->name, result->opsPerSec,
+            result->p50, result->p99);
+}
+
+
+void measure(Suite *suite, const char *name, void (*run)(Micro *micro, long operations), Micro *micro, long batch)
+{
+    /* EFFECT: Measures _samples_ batches of _batch_ operations of _run_ after one batch of warm-up */
+
+    double *perOp = malloc(suite->samples * sizeof(double));
+    if (!perOp)
+    {
+        return;
+    }
+
+    run(micro, batch);
+
+    double total = 0;
+    for (int i = 0; i < suite->samples; i++)
+    {
+        double start = now();
+        run(micro, batch);
+        double elapsed = now() - start;
+
+        perOp[i] = elapsed * 1e9 / batch;
+        total += elapsed;
+    }
+
+    record(suite, name, perOp, suite->samples, (double) batch * suite->samples, total);
+    free(perOp);
+}
+
+
+void runAllocFree(Micro *micro, long operations)
+{
+    int start = 0;
+    for (long i = 0; i < operations; i++)
+    {
+        memAlloc(1, &start);
+        memFreeBlock(start, 1);
+    }
+    micro->sink = start;
+}
+
+
+void runRead(Micro *micro, long operations)
+{
+    int value = 0;
+    int sum = 0;
+    for (long i = 0; i < operations; i++)
+    {
+        memRead(micro->indices[i & (INDEX_COUNT - 1)], &value);
+        sum += value;
+    }
+    micro->sink = sum;
+}
+
+
+void runWrite(Micro *micro, long operations)
+{
+    for (long i = 0; i < operations; i++)
+    {
+        memWrite(micro->indices[i & (INDEX_COUNT - 1)], (int) i);
+    }
+}
+
+
+void runLookup(Micro *micro, long operations)
+{
+    int found = 0;
+    for (long i = 0; i < operations; i++)
+    {
+        found += findArray(micro->names[micro->indices[i & (INDEX_COUNT - 1)]]) != NULL;
+    }
+    micro->sink = found;
+}
+
+
+void *sharedWorker(void *argument)
+{
+    /* EFFECT: Allocates and frees blocks of 1 to 4 cells in the shared memory, holding up to 4 at once */
+
+    Micro *micro = argument;
+    int starts[4];
+    int lengths[4];
+    int held = 0;
+
+    if (memAttach(micro->shared))
+    {
+        return NULL;
+    }
+
+    for (long i = 0; i < micro->operations; i++)
+    {
+        if (held == 4 || (held > 0 && (i & 1)))
+        {
+            held--;
+            memFreeBlock(starts[held], lengths[held]);
+        }
+        else if (memAlloc(1 + (i & 3), &starts[held]) == MEM_OK)
+        {
+            lengths[held++] = 1 + (i & 3);
+        }
+    }
+
+    while (held > 0)
+    {
+        held--;
+        memFreeBlock(starts[held], lengths[held]);
+    }
+    memFree();
+    return NULL;
+}
+
+
+void runSharedAllocFree(Micro *micro, long operations)
+{
+    pthread_t threads[8];
+
+    micro->operations = operations / micro->threads;
+    for (int i = 0; i < micro->threads; i++)
+    {
+        pthread_create(&threads[i], NULL, sharedWorker, micro);
+    }
+    for (int i = 0; i < micro->threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+
+void fragment(int holes)
+{
+    /* EFFECT: Fills the memory with single cells and frees _holes_ of them, spread evenly and never
+    adjacent, so the free list holds _holes_ segments of one cell */
+
+    int start;
+    resetAll();
+    for (int i = 0; i < MEM_CELLS; i++)
+    {
+        memAlloc(1, &start);
+    }
+
+    for (int i = 0; i < holes; i++)
+    {
+        memFreeBlock(i * (MEM_CELLS / holes), 1);
+    }
+}
+
+
+void benchMemory(Suite *suite, Micro *micro)
+{
+    static const int holeCounts[] = { 1, 10, 50 };
+    char name[64];
+
+    for (size_t i = 0; i < sizeof(holeCounts) / sizeof(holeCounts[0]); i++)
+    {
+        fragment(holeCounts[i]);
+        snprintf(name, sizeof(name), "memAllocFree/holes=%d", holeCounts[i]);
+        measure(suite, name, runAllocFree, micro, 100000);
+    }
+
+    int start;
+    resetAll();
+    memAlloc(MEM_CELLS, &start);
+    for (int i = 0; i < INDEX_COUNT; i++)
+    {
+        micro->indices[i] = rand() % MEM_CELLS;
+    }
+
+    measure(suite, "memRead/random", runRead, micro, 1000000);
+    measure(suite, "memWrite/random", runWrite, micro, 1000000);
+}
+
+
+void benchLookup(Suite *suite, Micro *micro)
+{
+    static const int arrayCounts[] = { 1, 10, 100 };
+    char name[64];
+
+    for (size_t i = 0; i < sizeof(arrayCounts) / sizeof(arrayCounts[0]); i++)
+    {
+        int count = arrayCounts[i];
+        resetAll();
+        for (int j = 0; j < count; j++)
+        {
+            snprintf(micro->names[j], sizeof(micro->names[j]), "array%d", j);
+            allocate(micro->names[j], 1);
+        }
+        for (int j = 0; j < INDEX_COUNT; j++)
+        {
+            micro->indices[j] = rand() % count;
+        }
+
+        snprintf(name, sizeof(name), "checkArray/arrays=%d", count);
+        measure(suite, name, runLookup, micro, 200000);
+    }
+}
+
+
+void benchShared(Suite *suite, Micro *micro)
+{
+    /* EFFECT: Measures the throughput of allocating from one memory shared by 1, 2, 4 and 8 threads */
+
+    char name[64];
+
+    memInit();
+    micro->shared = memShare();
+    if (!micro->shared)
+    {
+        return;
+    }
+
+    for (micro->threads = 1; micro->threads <= 8; micro->threads *= 2)
+    {
+        snprintf(name, sizeof(name), "memAllocShared/threads=%d", micro->threads);
+        measure(suite, name, runSharedAllocFree, micro, 400000);
+    }
+    memFree();
+}
+
+
+int writeWorkload(const char *kind, int lines, char *path)
+{
+    /* EFFECT: Writes a program of about _lines_ lines of the workload _kind_ to a new temporary file, 
+    whose name is written to _path_
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+
+    strcpy(path, "/tmp/ipwash-bench-XXXXXX");
+    int fd = mkstemp(path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!file)
+    {
+        return 1;
+    }
+
+    if (!strcmp(kind, "alloc"))
+    {
+        for (int i = 0; i < lines / 2; i++)
+        {
+            fprintf(file, "Mal a%d %d\nFre a%d\n", i % 7, 1 + i % 40, i % 7);
+        }
+    }
+    else if (!strcmp(kind, "inc"))
+    {
+        fprintf(file, "Mal a 100\n");
+        for (int i = 0; i < lines; i++)
+        {
+            fprintf(file, "%s a %d\n", i % 4 ? "Inc" : "Dec", i % 100);
+        }
+    }
+    else if (!strcmp(kind, "andxor"))
+    {
+        fprintf(file, "Mal a 48\nMal b 48\nAss a 1\nAss b 3\n");
+        for (int i = 0; i < lines; i++)
+        {
+            fprintf(file, "%s a b\n", i % 2 ? "Xor" : "And");
+        }
+    }
+    else
+    {
+        fprintf(file, "Mal a 10\n");
+        for (int i = 0; i < lines; i++)
+        {
+            if (i % 8)
+            {
+                fprintf(file, "Pri a %d\n", i % 10);
+            }
+            else
+            {
+                fprintf(file, "Pra a\n");
+            }
+        }
+    }
+
+    return fclose(file) != 0;
+}
+
+
+double runInterpreter(const Suite *suite, const char *path)
+{
+    /* EFFECT: Runs the interpreter on the program at _path_ with its output discarded
+    OUTPUT: The wall-clock time of the run in seconds; -1 if it could not be run */
+
+    const char *argv[MAX_ARGS + 3];
+    int argc = 0;
+    argv[argc++] = suite->interpreter;
+    for (int i = 0; i < suite->argCount; i++)
+    {
+        argv[argc++] = suite->args[i];
+    }
+    argv[argc++] = path;
+    argv[argc] = NULL;
+
+    double start = now();
+    pid_t child = fork();
+    if (child < 0)
+    {
+        return -1;
+    }
+
+    if (child == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(suite->interpreter, (char *const *) argv);
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        return -1;
+    }
+
+    return now() - start;
+}
+
+
+void benchWorkloads(Suite *suite)
+{
+    static const char *kinds[] = { "alloc", "inc", "andxor", "print" };
+    char name[64];
+    char path[64];
+
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+    {
+        if (writeWorkload(kinds[i], suite->lines, path))
+        {
+            fprintf(stderr, "Error: writing the %s workload failed\n", kinds[i]);
+            continue;
+        }
+
+        double *perOp = malloc(suite->samples * sizeof(double));
+        double total = 0;
+        int samples = 0;
+        for (int j = 0; perOp && j < suite->samples; j++)
+        {
+            double elapsed = runInterpreter(suite, path);
+            if (elapsed < 0)
+            {
+                fprintf(stderr, "Error: running %s failed\n", suite->interpreter);
+                break;
+            }
+
+            perOp[samples++] = elapsed * 1e9 / suite->lines;
+            total += elapsed;
+        }
+
+        if (samples)
+        {
+            snprintf(name, sizeof(name), "interpreter/%s", kinds[i]);
+            record(suite, name, perOp, samples, (double) suite->lines * samples, total);
+        }
+
+        free(perOp);
+        unlink(path);
+    }
+}
+
+
+int writeResults(const Suite *suite, const char *path)
+{
+    /* EFFECT: Writes the results of _suite_ as JSON to the file _path_, or to the standard output if 
+    _path_ is NULL
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+
+    FILE *file = path ? fopen(path, "w") : stdout;
+    if (!file)
+    {
+        return 1;
+    }
+
+    fprintf(file, "{\n  \"samples\": %d,\n  \"lines\": %d,\n  \"benchmarks\": [\n", suite->samples, suite->lines);
+    for (int i = 0; i < suite->count; i++)
+    {
+        const Result *result = &suite->results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ops_per_sec\": %.1f, \"p50_ns\": %.2f, \"p90_ns\": %.2f, "
+                "\"p99_ns\": %.2f}%s\n", result->name, result->opsPerSec, result->p50, result->p90, result->p99,
+                i + 1 < suite->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return path ? fclose(file) != 0 : fflush(file) != 0;
+}
+
+
+int compareBaseline(const Suite *suite, const char *path, double threshold)
+{
+    /* EFFECT: Prints the throughput of every benchmark next to its throughput in the results file _path_
+    written by an earlier run, marking drops of more than _threshold_ percent
+    OUTPUT: The number of regressions; -1 if _path_ could not be read */
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+
+    char *baseline = NULL;
+    size_t size = 0;
+    ssize_t length = getdelim(&baseline, &size, '\0', file);
+    fclose(file);
+    if (length < 0)
+    {
+        free(baseline);
+        return -1;
+    }
+
+    int regressions = 0;
+    char key[96];
+    fprintf(stderr, "\n%-28s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+    for (int i = 0; i < suite->count; i++)
+    {
+        const Result *result = &suite->results[i];
+        snprintf(key, sizeof(key), "\"name\": \"%s\"", result->name);
+
+        const char *entry = strstr(baseline, key);
+        const char *value = entry ? strstr(entry, "\"ops_per_sec\":") : NULL;
+        if (!value)
+        {
+            fprintf(stderr, "%-28s %14s %14.0f\n", result->name, "-", result->opsPerSec);
+            continue;
+        }
+
+        double before = strtod(value + strlen("\"ops_per_sec\":"), NULL);
+        double change = before > 0 ? (result->opsPerSec / before - 1) * 100 : 0;
+        int regressed = change < -threshold;
+        regressions += regressed;
+
+        fprintf(stderr, "%-28s %14.0f %14.0f %+8.1f%%%s\n", result->name, before, result->opsPerSec, change,
+                regressed ? "  REGRESSION" : "");
+    }
+    free(baseline);
+
+    return regressions;
+}
+
+
+int main(int argc, char *argv[])
+{
+    /* EFFECT: Runs the benchmark suite with the options described above
+    OUTPUT: 0 upon successful execution; 1 if the options are invalid or writing the results failed;
+    2 if a benchmark regressed against the baseline */
+
+    static Suite suite;
+    static Micro micro;
+    const char *out = NULL;
+    const char *baseline = NULL;
+    double threshold = 10;
+
+    suite.interpreter = "./interpreter";
+    suite.samples = 31;
+    suite.lines = 200000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            fprintf(stderr, "Error: option %s needs a value\n", argv[i]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--interpreter"))
+        {
+            suite.interpreter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--arg") && suite.argCount < MAX_ARGS)
+        {
+            suite.args[suite.argCount++] = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--samples"))
+        {
+            suite.samples = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--lines"))
+        {
+            suite.lines = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out"))
+        {
+            out = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--baseline"))
+        {
+            baseline = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threshold"))
+        {
+            threshold = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (suite.samples < 1 || suite.lines < 1)
+    {
+        fprintf(stderr, "Error: samples and lines must be positive\n");
+        return 1;
+    }
+
+    srand(1);
+    if (init())
+    {
+        return 1;
+    }
+    benchMemory(&suite, &micro);
+    benchLookup(&suite, &micro);
+    freeAll();
+    benchShared(&suite, &micro);
+
+    // Fewer samples of the slow end-to-end runs
+    int samples = suite.samples;
+    suite.samples = samples > 5 ? 5 : samples;
+    benchWorkloads(&suite);
+    suite.samples = samples;
+
+    if (writeResults(&suite, out))
+    {
+        fprintf(stderr, "Error: writing %s failed\n", out);
+        return 1;
+    }
+
+    if (baseline)
+    {
+        int regressions = compareBaseline(&suite, baseline, threshold);
+        if (regressions < 0)
+        {
+            fprintf(stderr, "Error: reading the baseline %s failed\n", baseline);
+            return 1;
+        }
+        if (regressions)
+        {
+            return 2;
+        }
+    }
+
+    return 0;
+}
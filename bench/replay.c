@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "memory.h"
+#include "output.h"
+
+/* Replays an allocator trace written with the --trace-alloc option of the interpreter against the 
+allocator of memory.c and reports how long the calls take and how fragmented the memory gets:
+
+    replay [--repeat N] [--policy NAME] TRACE
+
+For every allocation policy of memory.c, or only the one given, the trace is first replayed _repeat_ 
+times at full speed for timing, then once more while measuring the free space after every call. Blocks are matched by the address the trace recorded for them, so a changed 
+allocator may place them elsewhere; calls whose outcome differs from the trace are counted */
+
+/* Outcome of one replay of a trace */
+typedef struct Replay
+{
+    long allocs;
+    long reallocs;
+    long frees;
+    long failed;            // calls that failed in the replay
+    long mismatched;        // calls that failed in the trace but not in the replay, or the reverse
+    double fragmentation;   // mean of 1 - largest free segment / free cells after every call
+    double worst;           // worst fragmentation after a call
+    int segments;           // most free segments after a call
+} Replay;
+
+// Local functions
+double now(void);
+MemTraceEvent *readTrace(const char *path, long *count, int *cells);
+void replay(const MemTraceEvent *events, long count, int cells, int *actual, Replay *result, int measure);
+
+double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+MemTraceEvent *readTrace(const char *path, long *count, int *cells)
+{
+    /* EFFECT: Reads all events of the trace file _path_; their number is written to _count_ and the size
+    of the traced memory to _cells_
+    OUTPUT: The events; NULL if the trace could not be read */
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Error: opening %s failed\n", path);
+        return NULL;
+    }
+
+    MemTraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, MEM_TRACE_MAGIC, 4)
+        || header.version != MEM_TRACE_VERSION || header.eventSize != sizeof(MemTraceEvent))
+    {
+        fprintf(stderr, "Error: %s is not an allocator trace of this version\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    long capacity = 4096;
+    MemTraceEvent *events = malloc(capacity * sizeof(MemTraceEvent));
+    *count = 0;
+    while (events)
+    {
+        *count += fread(events + *count, sizeof(MemTraceEvent), capacity - *count, file);
+        if (*count < capacity)
+        {
+            break;
+        }
+
+        capacity *= 2;
+        MemTraceEvent *larger = realloc(events, capacity * sizeof(MemTraceEvent));
+        if (!larger)
+        {
+            free(events);
+            events = NULL;
+            break;
+        }
+        events = larger;
+    }
+    fclose(file);
+
+    if (!events)
+    {
+        fprintf(stderr, "Error: not enough memory to read %s\n", path);
+    }
+    *cells = (int) header.cells;
+
+    return events;
+}
+
+
+void replay(const MemTraceEvent *events, long count, int cells, int *actual, Replay *result, int measure)
+{
+    /* EFFECT: Replays the _count_ _events_ on freshly reset memory of _cells_ cells and counts their outcome 
+    in _result_. _actual_ maps the start of every block in the trace to its start in the replay. If _measure_ is set, 
+    the free space is inspected after every call */
+
+    memset(result, 0, sizeof(Replay));
+    memReset();
+
+    for (long i = 0; i < count; i++)
+    {
+        const MemTraceEvent *event = &events[i];
+        int tracedFailure = (event->flags & MEM_TRACE_FAILED) != 0;
+        int failed;
+
+        if (event->flags & MEM_TRACE_REALLOC)
+        {
+            result->reallocs++;
+            int from = event->from >= 0 && event->from < cells ? actual[event->from] : -1;
+            int start = -1;
+            failed = from < 0 || memRealloc(from, event->fromLength, event->length, &start) != MEM_OK;
+            if (!failed)
+            {
+                actual[event->from] = -1;
+            }
+            if (!tracedFailure && event->start >= 0 && event->start < cells)
+            {
+                actual[event->start] = failed ? -1 : start;
+            }
+        }
+        else if (event->flags & MEM_TRACE_FREE)
+        {
+            result->frees++;
+            int start = event->start >= 0 && event->start < cells ? actual[event->start] : -1;
+            failed = start < 0 || memFreeBlock(start, event->length) != MEM_OK;
+        }
+        else
+        {
+            result->allocs++;
+            int start = -1;
+            failed = memAlloc(event->length, &start) != MEM_OK;
+            if (!tracedFailure && event->start >= 0 && event->start < cells)
+            {
+                actual[event->start] = failed ? -1 : start;
+            }
+        }
+
+        result->failed += failed;
+        result->mismatched += failed != tracedFailure;
+
+        if (measure)
+        {
+            MemStats stats;
+            memStats(&stats);
+            double fragmentation = stats.freeCells ? 1 - (double) stats.largestFree / stats.freeCells : 0;
+            result->fragmentation += fragmentation;
+            if (fragmentation > result->worst)
+            {
+                result->worst = fragmentation;
+            }
+            if (stats.segments > result->segments)
+            {
+                result->segments = stats.segments;
+            }
+        }
+    }
+
+    if (measure && count)
+    {
+        result->fragmentation /= count;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    /* EFFECT: Replays the trace given as argument and prints the report
+    OUTPUT: 0 upon successful execution; 1 if the arguments are invalid or the trace cannot be read */
+
+    const char *path = NULL;
+    int repeat = 10;
+    int only = 0;
+    MemPolicy policy = MEM_BEST_FIT;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+        {
+            repeat = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--policy") && i + 1 < argc)
+        {
+            if (memPolicyByName(argv[++i], &policy))
+            {
+                fprintf(stderr, "Error: unknown allocation policy %s\n", argv[i]);
+                return 1;
+            }
+            only = 1;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (!path || repeat < 1)
+    {
+        fprintf(stderr, "Usage: %s [--repeat N] [--policy NAME] TRACE\n", argv[0]);
+        return 1;
+    }
+
+    long count;
+    int cells;
+    MemTraceEvent *events = readTrace(path, &count, &cells);
+    if (!events)
+    {
+        return 1;
+    }
+
+    // Replay on a memory of the size traced
+    int *actual = cells > 0 ? malloc(cells * sizeof(int)) : NULL;
+    if (!actual || memSetCells(cells))
+    {
+        fprintf(stderr, "Error: not enough memory to replay a memory of %d cells\n", cells);
+        free(actual);
+        free(events);
+        return 1;
+    }
+
+    // The allocator reports failures as the interpreter would; they are counted instead
+    FILE *null = fopen("/dev/null", "w");
+    setStreams(NULL, null);
+    memInit();
+
+    uint64_t traced = 0;
+    long allocs = 0;
+    long reallocs = 0;
+    for (long i = 0; i < count; i++)
+    {
+        traced += events[i].delta;
+        reallocs += (events[i].flags & MEM_TRACE_REALLOC) != 0;
+        allocs += !(events[i].flags & (MEM_TRACE_FREE | MEM_TRACE_REALLOC));
+    }
+
+    printf("%ld events (%ld allocations, %ld reallocations, %ld frees) over %.3f ms\n\n", count, allocs, reallocs,
+           count - allocs - reallocs, traced / 1e6);
+    printf("%-8s %12s %10s %8s %10s %10s %10s %9s\n", "policy", "ms/replay", "ns/call", "failed", "differing",
+           "mean frag", "worst frag", "segments");
+
+    Replay result;
+    for (int p = MEM_BEST_FIT; p <= MEM_WORST_FIT; p++)
+    {
+        if (only && p != (int) policy)
+        {
+            continue;
+        }
+        memSetPolicy((MemPolicy) p);
+
+        double start = now();
+        for (int i = 0; i < repeat; i++)
+        {
+            replay(events, count, cells, actual, &result, 0);
+        }
+        double elapsed = now() - start;
+
+        replay(events, count, cells, actual, &result, 1);
+        printf("%-8s %12.3f %10.1f %8ld %10ld %10.3f %10.3f %9d\n", memPolicyName((MemPolicy) p),
+               elapsed * 1e3 / repeat, count ? elapsed * 1e9 / repeat / count : 0, result.failed, result.mismatched,
+               result.fragmentation, result.worst, result.segments);
+    }
+
+    memFree();
+    setStreams(NULL, NULL);
+    if (null)
+    {
+        fclose(null);
+    }
+    free(actual);
+    free(events);
+
+    return 0;
+}
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "analysis.h"
+#include "binary.h"
+#include "interpreter.h"
+#include "program.h"
+
+// Local functions
+int writeStrings(char **strings, int count, FILE *file);
+size_t stringsSize(char **strings, int count);
+int indexStrings(const char *start, const char *end, uint64_t count, char ***table);
+int validNames(char **names, int count);
+int validInstruction(const Instruction *instruction, int nameCount, int operandCount, int textCount);
+int failingText(const char *text);
+
+size_t stringsSize(char **strings, int count)
+{
+    /* Local function
+    EFFECT: Computes the space _count_ _strings_ take including their terminating NUL characters
+    OUTPUT: The size in bytes */
+
+    size_t size = 0;
+    for (int i = 0; i < count; i++)
+    {
+        size += strlen(strings[i]) + 1;
+    }
+
+    return size;
+}
+
+
+int writeStrings(char **strings, int count, FILE *file)
+{
+    /* Local function
+    EFFECT: Writes _count_ _strings_ including their terminating NUL characters to _file_
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+
+    for (int i = 0; i < count; i++)
+    {
+        size_t size = strlen(strings[i]) + 1;
+        if (fwrite(strings[i], 1, size, file) != size)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int indexStrings(const char *start, const char *end, uint64_t count, char ***table)
+{
+    /* Local function
+    EFFECT: Builds a table of pointers to the _count_ consecutive NUL-terminated strings between 
+    _start_ and _end_
+    OUTPUT: 0 upon successful execution of the function; 1 if the strings do not fit; 
+    2 if allocating memory failed */
+
+    // Every string takes at least its NUL character
+    if (count > (uint64_t) (end - start))
+    {
+        return 1;
+    }
+
+    *table = malloc((count ? count : 1) * sizeof(char *));
+    if (!*table)
+    {
+        return 2;
+    }
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const char *nul = memchr(start, '\0', end - start);
+        if (!nul)
+        {
+            return 1;
+        }
+
+        (*table)[i] = (char *) start;
+        start = nul + 1;
+    }
+
+    return 0;
+}
+
+
+int validNames(char **names, int count)
+{
+    /* Local function
+    EFFECT: Checks that the _count_ _names_ are identifiers the decoder can produce, non-empty and without
+    the spaces and newlines it splits lines at, and that no identifier occurs twice, as the analysis
+    takes different slots for different arrays
+    OUTPUT: 0 if the names are valid; 1 if they are not; 2 if allocating memory failed */
+
+    Program set;
+    programInit(&set);
+
+    int error = 0;
+    for (int i = 0; i < count && !error; i++)
+    {
+        size_t length = strlen(names[i]);
+        if (!length || memchr(names[i], ' ', length) || memchr(names[i], '\n', length))
+        {
+            error = 1;
+            break;
+        }
+
+        int slot = programIntern(&set, names[i], length);
+        error = slot < 0 ? 2 : slot != i;
+    }
+
+    programFree(&set);
+
+    return error;
+}
+
+
+int validInstruction(const Instruction *instruction, int nameCount, int operandCount, int textCount)
+{
+    /* Local function
+    EFFECT: Checks that the operator, flags, slots, and operand or text index of _instruction_ are in range
+    OUTPUT: 1 if _instruction_ is valid; 0 otherwise */
+
+    if (instruction->flags & ~(INS_UNCHECKED | INS_FREE1 | INS_FREE2))
+    {
+        return 0;
+    }
+
+    switch (instruction->op)
+    {
+        case OP_RAW:
+            return instruction->slot1 == -1 && instruction->slot2 == -1 && !instruction->flags
+                   && instruction->value >= 0 && instruction->value < textCount;
+        case OP_FIL:
+        case OP_CPY:
+            if (instruction->value < 0 || instruction->value > operandCount - 3)
+            {
+                return 0;
+            }
+            if (instruction->op == OP_FIL)
+            {
+                if (instruction->slot2 != -1 || (instruction->flags & INS_FREE2))
+                {
+                    return 0;
+                }
+                break;
+            }
+            // fall through
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_AND:
+        case OP_XOR:
+            if (instruction->slot2 < 0 || instruction->slot2 >= nameCount)
+            {
+                return 0;
+            }
+            break;
+        case OP_ASS:
+        case OP_INC:
+        case OP_DEC:
+        case OP_MAL:
+        case OP_PRI:
+        case OP_FRE:
+        case OP_PRA:
+        case OP_BIT:
+        case OP_CNT:
+        case OP_SRT:
+        case OP_SCN:
+        case OP_SCX:
+        case OP_REA:
+            if (instruction->slot2 != -1 || (instruction->flags & INS_FREE2))
+            {
+                return 0;
+            }
+            break;
+        default:
+            return 0;
+    }
+
+    return instruction->slot1 >= 0 && instruction->slot1 < nameCount;
+}
+
+
+int failingText(const char *text)
+{
+    /* Local function
+    EFFECT: Checks whether _text_, the source line of an OP_RAW instruction, fails before executing anything, 
+    as the analysis assumes that execution stops at it
+    OUTPUT: 0 if _text_ fails to parse; 1 if it does not; 2 if allocating memory failed */
+
+    Instruction instruction;
+    Token name1;
+    Token name2;
+    int32_t operands[3];
+
+    int status = decodeLine(text, strlen(text), &instruction, &name1, &name2, operands);
+
+    return status == 2 ? 0 : status == 3 ? 2 : 1;
+}
+
+
+int isBinaryProgram(const void *data, size_t size)
+{
+    return size >= 4 && !memcmp(data, BINARY_MAGIC, 4);
+}
+
+
+int programWrite(const Program *program, FILE *file)
+{
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, 4);
+    header.version = BINARY_VERSION;
+    header.byteOrder = 0x01020304;
+    header.instructionSize = sizeof(Instruction);
+    header.instructionCount = program->length;
+    header.instructionOffset = (sizeof(header) + 7) & ~(uint64_t) 7;
+    header.nameCount = program->nameCount;
+    header.operandCount = program->operandCount;
+    header.operandOffset = header.instructionOffset + header.instructionCount * sizeof(Instruction);
+    header.nameOffset = header.operandOffset + header.operandCount * sizeof(int32_t);
+    header.textCount = program->textCount;
+    header.textOffset = header.nameOffset + stringsSize(program->names, program->nameCount);
+    header.size = header.textOffset + stringsSize(program->texts, program->textCount);
+
+    static const char padding[8] = { 0 };
+    size_t paddingSize = header.instructionOffset - sizeof(header);
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(padding, 1, paddingSize, file) != paddingSize)
+    {
+        return 1;
+    }
+
+    if (program->length && fwrite(program->code, sizeof(Instruction), program->length, file) != (size_t) program->length)
+    {
+        return 1;
+    }
+
+    if (program->operandCount
+        && fwrite(program->operands, sizeof(int32_t), program->operandCount, file) != (size_t) program->operandCount)
+    {
+        return 1;
+    }
+
+    if (writeStrings(program->names, program->nameCount, file) || writeStrings(program->texts, program->textCount, file))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int programMap(Program *program, const void *data, size_t size)
+{
+    BinaryHeader header;
+    if (size < sizeof(header))
+    {
+        return 1;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    // The layout must be exactly the one this process would write
+    if (memcmp(header.magic, BINARY_MAGIC, 4) || header.version != BINARY_VERSION || header.byteOrder != 0x01020304
+        || header.instructionSize != sizeof(Instruction) || header.size != size)
+    {
+        return 1;
+    }
+
+    if (header.instructionOffset % 8 || header.instructionOffset < sizeof(header) || header.instructionCount > INT32_MAX
+        || header.operandCount > INT32_MAX || header.nameCount > INT32_MAX || header.textCount > INT32_MAX
+        || header.instructionOffset > size
+        || header.instructionCount > (size - header.instructionOffset) / sizeof(Instruction)
+        || header.operandOffset != header.instructionOffset + header.instructionCount * sizeof(Instruction)
+        || header.operandCount > (size - header.operandOffset) / sizeof(int32_t)
+        || header.nameOffset != header.operandOffset + header.operandCount * sizeof(int32_t)
+        || header.textOffset < header.nameOffset || header.textOffset > size)
+    {
+        return 1;
+    }
+
+    const char *bytes = data;
+    int error = indexStrings(bytes + header.nameOffset, bytes + header.textOffset, header.nameCount, &program->names);
+    if (!error)
+    {
+        error = indexStrings(bytes + header.textOffset, bytes + size, header.textCount, &program->texts);
+    }
+    if (!error)
+    {
+        error = validNames(program->names, (int) header.nameCount);
+    }
+
+    program->code = (Instruction *) (bytes + header.instructionOffset);
+    program->length = (int) header.instructionCount;
+    program->operands = (int32_t *) (bytes + header.operandOffset);
+    program->operandCount = (int) header.operandCount;
+    program->nameCount = (int) header.nameCount;
+    program->textCount = (int) header.textCount;
+
+    for (int i = 0; i < program->length && !error; i++)
+    {
+        error = !validInstruction(&program->code[i], program->nameCount, program->operandCount, program->textCount);
+    }
+
+    for (int i = 0; i < program->textCount && !error; i++)
+    {
+        error = failingText(program->texts[i]);
+    }
+
+    if (!error)
+    {
+        int unsound = verifyBounds(program);
+        error = unsound < 0 ? 2 : unsound;
+    }
+
+    if (error)
+    {
+        free(program->names);
+        free(program->texts);
+        programInit(program);
+        return error;
+    }
+
+    program->analysed = 1;
+    program->mapping = (void *) data;
+    program->mappingSize = size;
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "program.h"
+
+/* Precompiled program file. All integers are in the byte order of the machine that wrote the file, 
+which is recorded in the header; files from machines with another byte order or layout are rejected.
+
+ offset 0                  BinaryHeader
+ instructionOffset         instructionCount Instruction records, as decoded and analysed, including the 
+                           line number of every instruction (the source line table)
+ operandOffset             operandCount int32_t operands of OP_FIL and OP_CPY instructions
+ nameOffset                nameCount NUL-terminated identifiers, in slot order
+ textOffset                textCount NUL-terminated source lines of OP_RAW instructions
+
+The instruction records are 8-byte aligned, so a mapped file is executed in place */
+#define BINARY_MAGIC "IPWB"
+#define BINARY_VERSION 6
+
+typedef struct BinaryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;         // 0x01020304 as written by the compiling machine
+    uint32_t instructionSize;   // sizeof(Instruction)
+    uint64_t instructionCount;
+    uint64_t instructionOffset;
+    uint64_t operandCount;
+    uint64_t operandOffset;
+    uint64_t nameCount;
+    uint64_t nameOffset;
+    uint64_t textCount;
+    uint64_t textOffset;
+    uint64_t size;              // size of the whole file
+} BinaryHeader;
+
+/* EFFECT: Checks whether the _size_ bytes at _data_ start like a precompiled program
+OUTPUT: 1 if _data_ starts with the magic number of precompiled programs; 0 otherwise */
+int isBinaryProgram(const void *data, size_t size);
+
+/* EFFECT: Writes the decoded and analysed _program_ to _file_ as precompiled program
+OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+int programWrite(const Program *program, FILE *file);
+
+/* EFFECT: Loads the precompiled program in the mapping of _size_ bytes at _data_ into the empty 
+_program_ without copying: the instructions, operands, and identifiers are used in place, and only 
+tables of pointers to the identifiers and lines are built. The file is validated, including that 
+the identifiers differ, the INS_UNCHECKED flags, and that the source line of every OP_RAW instruction 
+still fails to parse, so a corrupt file cannot make the executor access memory unchecked. On success 
+_program_ owns the mapping and unmaps it when freed
+OUTPUT: 0 upon successful execution of the function; 1 if the file is not a valid precompiled 
+program of this version; 2 if allocating memory failed */
+int programMap(Program *program, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binary.h"
+#include "cache.h"
+
+// Temporary files older than this (in seconds) were left behind by crashed writers
+#define STALE_AGE 3600
+
+// Rotation of a 32-bit word to the right, for SHA-256
+#define ROTATE(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+/* State of a SHA-256 computation */
+typedef struct Sha256
+{
+    uint32_t state[8];
+    unsigned char block[64];
+    size_t used;            // bytes in _block_
+    uint64_t length;        // bytes hashed in total
+} Sha256;
+
+/* An entry of the cache directory, as seen when evicting */
+typedef struct Entry
+{
+    char *name;
+    time_t used;
+    uint64_t size;
+} Entry;
+
+// Local functions
+void sha256Block(Sha256 *sha, const unsigned char *block);
+void sha256Update(Sha256 *sha, const void *data, size_t size);
+void sha256Final(Sha256 *sha, unsigned char *digest);
+void entryPath(char *path, size_t capacity, const char *directory, CacheKey key);
+int compareEntries(const void *a, const void *b);
+void evict(const char *directory, uint64_t limit);
+
+void sha256Block(Sha256 *sha, const unsigned char *block)
+{
+    /* Local function
+    EFFECT: Applies the SHA-256 compression function to the 64 bytes at _block_ */
+
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t) block[4 * i] << 24 | (uint32_t) block[4 * i + 1] << 16
+               | (uint32_t) block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROTATE(w[i - 15], 7) ^ ROTATE(w[i - 15], 18) ^ w[i - 15] >> 3;
+        uint32_t s1 = ROTATE(w[i - 2], 17) ^ ROTATE(w[i - 2], 19) ^ w[i - 2] >> 10;
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t v[8];
+    memcpy(v, sha->state, sizeof(v));
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = v[7] + (ROTATE(v[4], 6) ^ ROTATE(v[4], 11) ^ ROTATE(v[4], 25))
+                      + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+        uint32_t t2 = (ROTATE(v[0], 2) ^ ROTATE(v[0], 13) ^ ROTATE(v[0], 22))
+                      + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        sha->state[i] += v[i];
+    }
+}
+
+
+void sha256Update(Sha256 *sha, const void *data, size_t size)
+{
+    /* Local function
+    EFFECT: Adds the _size_ bytes at _data_ to the message hashed by _sha_ */
+
+    const unsigned char *bytes = data;
+    sha->length += size;
+
+    while (size)
+    {
+        size_t take = 64 - sha->used < size ? 64 - sha->used : size;
+        memcpy(sha->block + sha->used, bytes, take);
+        sha->used += take;
+        bytes += take;
+        size -= take;
+
+        if (sha->used == 64)
+        {
+            sha256Block(sha, sha->block);
+            sha->used = 0;
+        }
+    }
+}
+
+
+void sha256Final(Sha256 *sha, unsigned char *digest)
+{
+    /* Local function
+    EFFECT: Pads the message hashed by _sha_ and stores its digest of CACHE_DIGEST_SIZE bytes in _digest_ */
+
+    uint64_t bits = sha->length * 8;
+    unsigned char padding[72] = { 0x80 };
+    size_t padLength = (sha->used < 56 ? 56 : 120) - sha->used;
+
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padLength + i] = (unsigned char) (bits >> (56 - 8 * i));
+    }
+    sha256Update(sha, padding, padLength + 8);
+
+    for (int i = 0; i < 8; i++)
+    {
+        digest[4 * i] = (unsigned char) (sha->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char) (sha->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char) (sha->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char) sha->state[i];
+    }
+}
+
+
+void entryPath(char *path, size_t capacity, const char *directory, CacheKey key)
+{
+    /* Local function
+    EFFECT: Writes the path of the entry for _key_ in _directory_ to _path_ */
+
+    char name[2 * CACHE_DIGEST_SIZE + 1];
+    for (int i = 0; i < CACHE_DIGEST_SIZE; i++)
+    {
+        snprintf(name + 2 * i, 3, "%02x", key.digest[i]);
+    }
+
+    snprintf(path, capacity, "%s/%s-%llx.ipwb", directory, name, (unsigned long long) key.size);
+}
+
+
+int compareEntries(const void *a, const void *b)
+{
+    time_t usedA = ((const Entry *) a)->used;
+    time_t usedB = ((const Entry *) b)->used;
+
+    return (usedA > usedB) - (usedA < usedB);
+}
+
+
+void evict(const char *directory, uint64_t limit)
+{
+    /* Local function
+    EFFECT: Removes the least recently used entries of the cache in _directory_ until the rest takes at 
+    most _limit_ bytes, as well as stale temporary files. Entries that other processes remove at the 
+    same time are skipped, and processes that still map a removed entry keep using it */
+
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        return;
+    }
+
+    Entry *entries = NULL;
+    int count = 0;
+    int capacity = 0;
+    uint64_t total = 0;
+    time_t now = time(NULL);
+    char path[4096];
+
+    struct dirent *item;
+    while ((item = readdir(dir)))
+    {
+        const char *name = item->d_name;
+        size_t length = strlen(name);
+        int temporary = !strncmp(name, ".tmp-", 5);
+        if (!temporary && (length < 5 || strcmp(name + length - 5, ".ipwb")))
+        {
+            continue;
+        }
+
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", directory, name);
+        if (stat(path, &info) || !S_ISREG(info.st_mode))
+        {
+            continue;
+        }
+
+        if (temporary)
+        {
+            if (now - info.st_mtime > STALE_AGE)
+            {
+                unlink(path);
+            }
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            int newCapacity = capacity ? capacity * 2 : 64;
+            Entry *larger = realloc(entries, newCapacity * sizeof(Entry));
+            if (!larger)
+            {
+                break;
+            }
+            entries = larger;
+            capacity = newCapacity;
+        }
+
+        entries[count].name = strdup(name);
+        if (!entries[count].name)
+        {
+            break;
+        }
+        entries[count].used = info.st_mtime;
+        entries[count].size = (uint64_t) info.st_size;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(entries, count, sizeof(Entry), compareEntries);
+    for (int i = 0; i < count; i++)
+    {
+        if (total > limit)
+        {
+            snprintf(path, sizeof(path), "%s/%s", directory, entries[i].name);
+            unlink(path);
+            total -= entries[i].size;
+        }
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+
+CacheKey cacheKey(const void *data, size_t size, int variant)
+{
+    Sha256 sha = { { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 
+                     0x5be0cd19 }, { 0 }, 0, 0 };
+    sha256Update(&sha, data, size);
+
+    // Entries analysed with other options or written by another version of the format differ
+    uint32_t options[2] = { (uint32_t) variant, BINARY_VERSION };
+    sha256Update(&sha, options, sizeof(options));
+
+    CacheKey key;
+    sha256Final(&sha, key.digest);
+    key.size = size;
+
+    return key;
+}
+
+
+int cacheLoad(const char *directory, CacheKey key, Program *program)
+{
+    char path[4096];
+    entryPath(path, sizeof(path), directory, key);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    // The digest of the source follows the precompiled program; an entry of another source is left to
+    // the eviction, as it is valid for that source
+    struct stat info;
+    unsigned char digest[CACHE_DIGEST_SIZE];
+    if (fstat(fd, &info) || info.st_size <= CACHE_DIGEST_SIZE
+        || pread(fd, digest, CACHE_DIGEST_SIZE, info.st_size - CACHE_DIGEST_SIZE) != CACHE_DIGEST_SIZE
+        || memcmp(digest, key.digest, CACHE_DIGEST_SIZE))
+    {
+        close(fd);
+        return 1;
+    }
+
+    size_t size = (size_t) info.st_size - CACHE_DIGEST_SIZE;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return 1;
+    }
+
+    // Mark the entry as recently used for the eviction
+    futimens(fd, NULL);
+    close(fd);
+
+    int status = programMap(program, data, size);
+    if (status)
+    {
+        munmap(data, size);
+        if (status == 1)
+        {
+            unlink(path);
+        }
+        return status;
+    }
+
+    return 0;
+}
+
+
+int cacheStore(const char *directory, CacheKey key, const Program *program, uint64_t limit)
+{
+    char temporary[4096];
+    char path[4096];
+    snprintf(temporary, sizeof(temporary), "%s/.tmp-XXXXXX", directory);
+    entryPath(path, sizeof(path), directory, key);
+
+    int fd = mkstemp(temporary);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    FILE *file = fdopen(fd, "wb");
+    if (!file)
+    {
+        close(fd);
+        unlink(temporary);
+        return 1;
+    }
+
+    // mkstemp() creates private files, but entries are shared like ordinary files
+    fchmod(fd, 0644);
+    int error = programWrite(program, file)
+                || fwrite(key.digest, 1, CACHE_DIGEST_SIZE, file) != CACHE_DIGEST_SIZE;
+    if (fclose(file) || error || rename(temporary, path))
+    {
+        unlink(temporary);
+        return 1;
+    }
+
+    evict(directory, limit);
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "program.h"
+
+/* On-disk cache of precompiled programs (see binary.h), shared by all interpreter processes using the
+same directory. Entries are named after the SHA-256 digest of the source they were compiled from, which
+also follows the precompiled program in the entry and is compared before the entry is used. They are 
+written to a temporary file and renamed into place, so readers never see a partial entry. The modification time of 
+an entry is refreshed whenever it is used, and the least recently used entries are removed once the 
+entries take more than the size limit */
+
+// Size limit of the cache directory unless one is given
+#define CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+#define CACHE_DIGEST_SIZE 32
+
+/* Identifies the source of a program and the options it was analysed with */
+typedef struct CacheKey
+{
+    unsigned char digest[CACHE_DIGEST_SIZE];    // SHA-256 digest of the source and the options
+    uint64_t size;                              // size of the source
+} CacheKey;
+
+/* EFFECT: Computes the cache key of the _size_ characters of source at _data_ analysed with the 
+options encoded in _variant_ (e.g. whether arrays are freed early)
+OUTPUT: The cache key */
+CacheKey cacheKey(const void *data, size_t size, int variant);
+
+/* EFFECT: Loads the entry for _key_ from the cache in _directory_ into the empty _program_ and marks it
+as recently used, after checking that it was compiled from the source with the digest of _key_. 
+Invalid entries, e.g. from another version of the interpreter, are removed
+OUTPUT: 0 upon successful execution of the function; 1 if there is no valid entry; 
+2 if allocating memory failed */
+int cacheLoad(const char *directory, CacheKey key, Program *program);
+
+/* EFFECT: Writes the analysed _program_ to the cache in _directory_ as entry for _key_, then removes the 
+least recently used entries until the cache takes at most _limit_ bytes
+OUTPUT: 0 upon successful execution of the function; 1 if writing the entry failed */
+int cacheStore(const char *directory, CacheKey key, const Program *program, uint64_t limit);
+
+#endif
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+int sendProgram(int fd, FILE *file);
+int receiveAll(int fd, void *data, size_t size);
+int receiveFrames(int fd);
+
+int sendProgram(int fd, FILE *file)
+{
+    /* EFFECT: Sends the contents of _file_ over _fd_ and shuts down the writing side
+    OUTPUT: 0 upon successful execution; 1 if reading or sending failed */
+
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        const char *bytes = buffer;
+        while (n)
+        {
+            ssize_t sent = send(fd, bytes, n, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sent <= 0)
+            {
+                return 1;
+            }
+            bytes += sent;
+            n -= sent;
+        }
+    }
+
+    return ferror(file) || shutdown(fd, SHUT_WR);
+}
+
+
+int receiveAll(int fd, void *data, size_t size)
+{
+    /* EFFECT: Receives exactly _size_ bytes from _fd_ into _data_
+    OUTPUT: 0 upon successful execution; 1 if the connection closed or failed */
+
+    char *bytes = data;
+    while (size)
+    {
+        ssize_t n = recv(fd, bytes, size, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return 1;
+        }
+        bytes += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+
+int receiveFrames(int fd)
+{
+    /* EFFECT: Receives the frames of the answer from _fd_ and writes output and error messages to the
+    standard output and error streams
+    OUTPUT: The exit status sent by the server; 2 if the connection failed */
+
+    for (;;)
+    {
+        unsigned char header[5];
+        uint32_t length;
+        if (receiveAll(fd, header, sizeof(header)))
+        {
+            return 2;
+        }
+        memcpy(&length, header + 1, sizeof(length));
+        length = ntohl(length);
+
+        char *payload = malloc(length ? length : 1);
+        if (!payload || receiveAll(fd, payload, length))
+        {
+            free(payload);
+            return 2;
+        }
+
+        if (header[0] == FRAME_STATUS && length == sizeof(uint32_t))
+        {
+            uint32_t status;
+            memcpy(&status, payload, sizeof(status));
+            free(payload);
+            return (int) ntohl(status);
+        }
+
+        fwrite(payload, 1, length, header[0] == FRAME_ERROR ? stderr : stdout);
+        free(payload);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    /* EFFECT: Sends the program in the file given as second argument (or standard input) to the 
+    interpreter server listening on the socket given as first argument, and prints what it answers
+    OUTPUT: The exit status of the program; 2 if communicating with the server failed */
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s socket [file]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = argc == 3 ? fopen(argv[2], "r") : stdin;
+    if (!file)
+    {
+        fprintf(stderr, "Error: opening file failed\n");
+        return 2;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)))
+    {
+        fprintf(stderr, "Error: connecting to %s failed\n", argv[1]);
+        return 2;
+    }
+
+    // The server may answer before it has read everything, e.g. when the program is too large
+    int failed = sendProgram(fd, file);
+    int status = receiveFrames(fd);
+    if (status == 2)
+    {
+        fprintf(stderr, failed ? "Error: sending the program failed\n" : "Error: receiving the answer failed\n");
+    }
+    close(fd);
+
+    return status;
+}
@@ -1,29 +1,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "functions.h"
 #include "memory.h"
+#include "output.h"
+#include "pool.h"
 
 /* Custom list data type that stores the identifier of an array (_arrayName_), 
 the length of the array (_length_), and it's address in memory (_address_) */
-typedef struct Array
+struct Array
 {
     char *arrayName;
     int length;
     int address;
+    int bits;           // 1 if the elements are single bits, packed BITS_PER_CELL to a cell
     struct Array *next;
-} Array;
+};
 
-// Creates static HEAD to list with array identifiers
-static Array *arrays = NULL;
+// Elements of a bit array per memory cell. Bits of the last cell beyond the length are always 0
+#define BITS_PER_CELL 32
+
+// Creates static HEAD to list with array identifiers. Each thread has its own list, like its own memory
+static _Thread_local Array *arrays = NULL;
+
+// Pool sharing out pointwise operations on large arrays (see setArrayPool()). Set before threads start
+static Pool *arrayPool = NULL;
+
+// Pointwise operations on arrays of at least PARALLEL_LENGTH elements run in chunks of CHUNK_LENGTH 
+// elements on _arrayPool_; the chunk of both arrays fits in the L2 cache of a core
+#define PARALLEL_LENGTH 65536
+#define CHUNK_LENGTH 8192
+
+/* Pointwise operation shared out in chunks */
+typedef struct Pointwise
+{
+    int *cells1;
+    const int *cells2;
+    int length;
+    char operator;
+} Pointwise;
+
+/* Prefix sum shared out in chunks: the first pass sums every chunk into _carries_, which then hold the 
+sum of all chunks before each, added by the second pass that scans the chunks */
+typedef struct Scan
+{
+    int *cells;
+    int length;
+    unsigned int *carries;
+    int exclusive;
+} Scan;
+
+// Sorting falls back from radix sort to introsort, which sorts ranges of up to SORT_INSERTION elements
+// by insertion
+#define SORT_INSERTION 16
 
 // Local functions
 static Array *checkArray(const char *arrayName);
-int fetchAddress(const char *arrayName, int index);
+int fetchAddress(const char *arrayName, int index, int *bit);
 int freeArrayName(const char *arrayName, int *addressAndLength);
+int cellCount(const Array *array);
+int readBit(int address, int bit, int *value);
+int writeBit(int address, int bit, int value);
+int readElement(const Array *array, int index, int *value);
+int writeElement(const Array *array, int index, int value);
+int bitOperator(Array *array1, Array *array2, char operator, int n);
+int allocateArray(const char *arrayName, int length, int bits);
+int applyOperator(int value1, int value2, char operator, int *result);
 int singleElementOperation(int address, int value1, int value2, char operator);
 int executeDualArrayOperator(Array *array1, Array *array2, char operator, int onlyFirstElement);
 int dualArrayOperator(const char *arrayName1, const char *arrayName2, char operator, int onlyFirstElement);
+void pointwiseChunk(void *context, int chunk);
+int pointwiseParallel(Array *array1, Array *array2, char operator);
+void insertionSort(int *values, int n);
+void heapSort(int *values, int n);
+void introSort(int *values, int n, int depth);
+void radixSort(int *values, int *scratch, int n);
+void sortValues(int *values, int n, int *scratch);
+int sortCells(Array *array);
+int sortCopy(Array *array);
+int sortBits(Array *array);
+unsigned int sumBlock(const int *values, int n);
+unsigned int scanBlock(int *values, int n, unsigned int carry, int exclusive);
+void scanSumChunk(void *context, int chunk);
+void scanChunk(void *context, int chunk);
+int scanParallel(int *cells, int length, int exclusive);
+int scanElements(Array *array, int exclusive);
+int checkRange(const Array *array, int start, int length);
+int fillElements(Array *array, int value, int start, int length);
+int copyElements(Array *to, Array *from, int start1, int start2, int length);
 
 static Array *checkArray(const char *arrayName)
 {
@@ -50,10 +117,11 @@ static Array *checkArray(const char *arrayName)
 }
 
 
-int fetchAddress(const char *arrayName, int index)
+int fetchAddress(const char *arrayName, int index, int *bit)
 {
     /* Local function 
-    EFFECT: Check whether the array with identifier _arrayName_ exists and whether index is within its range
+    EFFECT: Check whether the array with identifier _arrayName_ exists and whether index is within its range.
+    For bit arrays the position of the element in its cell is stored in _bit_, otherwise -1
     OUTPUT: The address in memory of the element with index _index_ of the array with the identifier _arrayName_; 
     -1 if no array with the identifier _arrayName_ exists; 
     -2 if index is outside of the range of the array with identifier _arrayName_ */
@@ -63,15 +131,16 @@ int fetchAddress(const char *arrayName, int index)
     {
         if (index >= 0 && index < array->length)
         {
-            return array->address + index;
+            *bit = array->bits ? index % BITS_PER_CELL : -1;
+            return array->address + (array->bits ? index / BITS_PER_CELL : index);
         }
 
-        fprintf(stderr, "Wrong Memory Access.\n");
+        fprintf(errStream(), "Wrong Memory Access.\n");
         // fprintf(stderr, "Error: index %d is outside of the range of the array with identifier %s\n", index, arrayName);
         return -2;
     }
 
-    fprintf(stderr, "Try to use a variable that does not exist.\n");
+    fprintf(errStream(), "Try to use a variable that does not exist.\n");
     // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName);
     return -1;
 }
@@ -96,7 +165,7 @@ int freeArrayName(const char *arrayName, int *addressAndLength)
             if (!strcmp(array->arrayName, arrayName))
             {
                 addressAndLength[0] = array->address;
-                addressAndLength[1] = array->length;
+                addressAndLength[1] = cellCount(array);
 
                 if (previous)
                 {
@@ -118,45 +187,137 @@ int freeArrayName(const char *arrayName, int *addressAndLength)
         }
     }
 
-    fprintf(stderr, "Try to use a variable that does not exist.\n");
+    fprintf(errStream(), "Try to use a variable that does not exist.\n");
     // fprintf(stderr, "Error: no array with identifier %s exists\n", arrayName); 
     return 1;
 }
 
 
-int singleElementOperation(int address, int value1, int value2, char operator)
+int cellCount(const Array *array)
 {
     /* Local function
-    EFFECT: Computes result of _operator_ _value1_ _value2_ and writes result to _address_
+    OUTPUT: The number of memory cells taken by _array_ */
+
+    return array->bits ? (array->length - 1) / BITS_PER_CELL + 1 : array->length;
+}
+
+
+int readBit(int address, int bit, int *value)
+{
+    /* Local function
+    EFFECT: Reads bit _bit_ of the cell at _address_ into _value_
+    OUTPUT: 0 upon successful execution of the function; 1 if reading the cell failed */
+
+    int cell;
+    if (memRead(address, &cell))
+    {
+        return 1;
+    }
+
+    *value = (unsigned int) cell >> bit & 1;
+
+    return 0;
+}
+
+
+int writeBit(int address, int bit, int value)
+{
+    /* Local function
+    EFFECT: Sets bit _bit_ of the cell at _address_ to the lowest bit of _value_
+    OUTPUT: 0 upon successful execution of the function; 1 if reading or writing the cell failed */
+
+    int cell;
+    if (memRead(address, &cell))
+    {
+        return 1;
+    }
+
+    unsigned int mask = 1u << bit;
+    unsigned int word = ((unsigned int) cell & ~mask) | ((value & 1u) << bit);
+
+    return memWrite(address, (int) word) != 0;
+}
+
+
+int readElement(const Array *array, int index, int *value)
+{
+    /* Local function
+    EFFECT: Reads element _index_ of _array_, of either kind, into _value_
+    OUTPUT: 0 upon successful execution of the function; 1 if reading failed */
+
+    if (array->bits)
+    {
+        return readBit(array->address + index / BITS_PER_CELL, index % BITS_PER_CELL, value);
+    }
+
+    return memRead(array->address + index, value) != 0;
+}
+
+
+int writeElement(const Array *array, int index, int value)
+{
+    /* Local function
+    EFFECT: Writes _value_ to element _index_ of _array_; bit arrays keep its lowest bit
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
+
+    if (array->bits)
+    {
+        return writeBit(array->address + index / BITS_PER_CELL, index % BITS_PER_CELL, value);
+    }
+
+    return memWrite(array->address + index, value) != 0;
+}
+
+
+int applyOperator(int value1, int value2, char operator, int *result)
+{
+    /* Local function
+    EFFECT: Computes result of _operator_ _value1_ _value2_ and stores it in _result_
     OUTPUT: 0 upon successful execution of the function; 
     1 if no or an invalid operator was given */
 
-    int result = 0;
     if (operator == '+')
     {
-        result = value1 + value2;
+        *result = value1 + value2;
     }
     else if (operator == '-')
     {
-        result = value1 - value2;
+        *result = value1 - value2;
     }
     else if (operator == '*')
     {
-        result = value1 * value2;
+        *result = value1 * value2;
     }
     else if (operator == '&')
     {
-        result = (value1 * value2) % 2;
+        *result = (value1 * value2) % 2;
     }
     else if (operator == '^')
     {
-        result = (value1 + value2) % 2;
+        *result = (value1 + value2) % 2;
     }
     else
     {
         return 1;
     }
 
+    return 0;
+}
+
+
+int singleElementOperation(int address, int value1, int value2, char operator)
+{
+    /* Local function
+    EFFECT: Computes result of _operator_ _value1_ _value2_ and writes result to _address_
+    OUTPUT: 0 upon successful execution of the function; 
+    1 if no or an invalid operator was given */
+
+    int result = 0;
+    if (applyOperator(value1, value2, operator, &result))
+    {
+        return 1;
+    }
+
     if (memWrite(address, result))
     {
         return 2;
@@ -166,6 +327,123 @@ int singleElementOperation(int address, int value1, int value2, char operator)
 }
 
 
+void pointwiseChunk(void *context, int chunk)
+{
+    /* Local function
+    EFFECT: Pool task computing chunk _chunk_ of the pointwise operation _context_, as applyOperator() 
+    would */
+
+    const Pointwise *pointwise = context;
+    int *cells1 = pointwise->cells1;
+    const int *cells2 = pointwise->cells2;
+    int start = chunk * CHUNK_LENGTH;
+    int end = pointwise->length - start < CHUNK_LENGTH ? pointwise->length : start + CHUNK_LENGTH;
+
+    if (pointwise->operator == '&')
+    {
+        for (int i = start; i < end; i++)
+        {
+            cells1[i] = (cells1[i] * cells2[i]) % 2;
+        }
+    }
+    else
+    {
+        for (int i = start; i < end; i++)
+        {
+            cells1[i] = (cells1[i] + cells2[i]) % 2;
+        }
+    }
+}
+
+
+int pointwiseParallel(Array *array1, Array *array2, char operator)
+{
+    /* Local function
+    EFFECT: Computes _operator_ pointwise on the arrays _array1_ and _array2_ of the same length in chunks 
+    on the threads of the array pool, if the arrays are large enough to be worth it and all their cells 
+    are allocated, so that no chunk can fail
+    OUTPUT: 0 if the operation was computed; 1 if it is left to the caller */
+
+    if (!arrayPool || array1->length < PARALLEL_LENGTH || (operator != '&' && operator != '^'))
+    {
+        return 1;
+    }
+
+    int *cells1 = memRange(array1->address, array1->length);
+    const int *cells2 = memRange(array2->address, array2->length);
+    if (!cells1 || !cells2)
+    {
+        return 1;
+    }
+
+    Pointwise pointwise = { cells1, cells2, array1->length, operator };
+    int chunks = (array1->length + CHUNK_LENGTH - 1) / CHUNK_LENGTH;
+    for (int i = 0; i < chunks; i++)
+    {
+        poolSubmit(arrayPool, pointwiseChunk, &pointwise, i);
+    }
+    poolWait(arrayPool);
+
+    return 0;
+}
+
+
+int bitOperator(Array *array1, Array *array2, char operator, int n)
+{
+    /* Local function
+    EFFECT: Computes _operator_ on the first _n_ elements of _array1_ and _array2_, of which at least one 
+    is a bit array, and writes the results to _array1_. And and Xor of two bit arrays run on whole cells, 
+    which is what (a * b) % 2 and (a + b) % 2 amount to for single bits
+    OUTPUT: 0 upon successful execution of the function; 1 if reading the elements of _array1_ failed;
+    2 if reading the elements of _array2_ failed; 3 if writing to _array1_ failed; 
+    4 if no or an invalid operator was supplied */
+
+    if (array1->bits && array2->bits && n > 1 && (operator == '&' || operator == '^'))
+    {
+        int *cells1 = memRange(array1->address, cellCount(array1));
+        const int *cells2 = memRange(array2->address, cellCount(array2));
+        if (cells1 && cells2)
+        {
+            for (int i = 0, cells = cellCount(array1); i < cells; i++)
+            {
+                cells1[i] = operator == '&' ? cells1[i] & cells2[i] : cells1[i] ^ cells2[i];
+            }
+
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int element1;
+        if (readElement(array1, i, &element1))
+        {
+            return 1;
+        }
+
+        int element2;
+        if (readElement(array2, i, &element2))
+        {
+            return 2;
+        }
+
+        int result = 0;
+        if (applyOperator(element1, element2, operator, &result))
+        {
+            fprintf(errStream(), "Error: invalid or no operator supplied\n");
+            return 4;
+        }
+
+        if (writeElement(array1, i, result))
+        {
+            return 3;
+        }
+    }
+
+    return 0;
+}
+
+
 int executeDualArrayOperator(Array *array1, Array *array2, char operator, int onlyFirstElement)
 {
     /* Local function
@@ -186,7 +464,7 @@ int executeDualArrayOperator(Array *array1, Array *array2, char operator, int on
         // Check whether arrays are of same length
         if (array1->length != array2->length)
         {
-            fprintf(stderr, "Logic operation between sequences of different length.\n");
+            fprintf(errStream(), "Logic operation between sequences of different length.\n");
             // fprintf(stderr, "Error: a point-wise AND or XOR operation cannot be performed on the array with identifier %s of length %d and the array with identifier %s of length %d. The length of the arrays must be the same\n", array1->arrayName, array1->length, array2->arrayName, array2->length);
             return 5;
         }
@@ -194,6 +472,16 @@ int executeDualArrayOperator(Array *array1, Array *array2, char operator, int on
         n = array1->length;
     }
 
+    if (array1->bits || array2->bits)
+    {
+        return bitOperator(array1, array2, operator, n);
+    }
+
+    if (n > 1 && !pointwiseParallel(array1, array2, operator))
+    {
+        return 0;
+    }
+
     for (i = 0; i < n; i++)
     {
         int element1;
@@ -215,7 +503,7 @@ int executeDualArrayOperator(Array *array1, Array *array2, char operator, int on
         {
             if (error == 1)
             {
-                fprintf(stderr, "Error: invalid or no operator supplied\n");
+                fprintf(errStream(), "Error: invalid or no operator supplied\n");
                 return 4;
             }
             if (error == 2)
@@ -229,40 +517,614 @@ int executeDualArrayOperator(Array *array1, Array *array2, char operator, int on
     return 0;
 }
 
-int dualArrayOperator(const char *arrayName1, const char *arrayName2, char operator, int onlyFirstElement)
+int dualArrayOperator(const char *arrayName1, const char *arrayName2, char operator, int onlyFirstElement)
+{
+    /* Local function
+    EFFECT: Computes the result of performing the operator associated with _operator_ on the array
+    with identifier _arrayName1_ and the array with identifier _arrayName2_ and writes result to 
+    the array with identifier _arrayName1_. If _onlyFirstElement_ is 1, the operation is only done 
+    on the first element of the array with identifier _arrayName1_ and the array with identifier 
+    _arrayName2_. If _onlyFirstElement_ is 0, the array with identifier _arrayName1_ and the array
+    with identifier _arrayName2_ must be the same lenght, and the operation will be done pointwise 
+    on each element of the arrays
+    OUTPUT: 0 upon successful execution of the function; 
+    1 if fetching the array with the identifier _arrayName1_ failed; 
+    2 if fetching the array with the identifier _arrayName2_ failed;
+    3 if reading, writing, or computing the result failed */
+
+    Array *array1 = checkArray(arrayName1);
+    if (!array1 || array1->address < 0)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName1);
+        return 1;
+    }
+
+    Array *array2 = checkArray(arrayName2);
+    if (!array2 || array2->address < 0)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName2);
+        return 2;
+    }
+
+    if (executeDualArrayOperator(array1, array2, operator, onlyFirstElement))
+    {
+        return 3;
+    }
+
+    return 0;
+}
+
+
+void insertionSort(int *values, int n)
+{
+    /* Local function
+    EFFECT: Sorts the _n_ _values_ in ascending order by insertion */
+
+    for (int i = 1; i < n; i++)
+    {
+        int value = values[i];
+        int j = i;
+        for (; j > 0 && values[j - 1] > value; j--)
+        {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+}
+
+
+void heapSort(int *values, int n)
+{
+    /* Local function
+    EFFECT: Sorts the _n_ _values_ in ascending order using a max-heap */
+
+    for (int end = n, i = n / 2 - 1; end > 1; )
+    {
+        // Build the heap first, then repeatedly move its maximum behind it
+        int root;
+        if (i >= 0)
+        {
+            root = i--;
+        }
+        else
+        {
+            int top = values[0];
+            values[0] = values[--end];
+            values[end] = top;
+            root = 0;
+        }
+
+        int value = values[root];
+        for (int child = 2 * root + 1; child < end; child = 2 * root + 1)
+        {
+            if (child + 1 < end && values[child + 1] > values[child])
+            {
+                child++;
+            }
+            if (values[child] <= value)
+            {
+                break;
+            }
+            values[root] = values[child];
+            root = child;
+        }
+        values[root] = value;
+    }
+}
+
+
+void introSort(int *values, int n, int depth)
+{
+    /* Local function
+    EFFECT: Sorts the _n_ _values_ in ascending order in place by quicksort, switching to heap sort once 
+    _depth_ partitions are nested, so that the worst case stays O(n log n) */
+
+    while (n > SORT_INSERTION)
+    {
+        if (depth-- == 0)
+        {
+            heapSort(values, n);
+            return;
+        }
+
+        // Median of the first, middle, and last value as pivot
+        int a = values[0];
+        int b = values[n / 2];
+        int c = values[n - 1];
+        int pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+        // Hoare partition: [0, j] holds no value above the pivot, (j, n) none below it
+        int i = -1;
+        int j = n;
+        for (;;)
+        {
+            do
+            {
+                i++;
+            } while (values[i] < pivot);
+            do
+            {
+                j--;
+            } while (values[j] > pivot);
+
+            if (i >= j)
+            {
+                break;
+            }
+
+            int value = values[i];
+            values[i] = values[j];
+            values[j] = value;
+        }
+
+        // Recurse into the smaller part and continue with the larger one, bounding the stack
+        int left = j + 1;
+        if (left < n - left)
+        {
+            introSort(values, left, depth);
+            values += left;
+            n -= left;
+        }
+        else
+        {
+            introSort(values + left, n - left, depth);
+            n = left;
+        }
+    }
+
+    insertionSort(values, n);
+}
+
+
+void radixSort(int *values, int *scratch, int n)
+{
+    /* Local function
+    EFFECT: Sorts the _n_ _values_ in ascending order by a least significant digit radix sort over their
+    four bytes, using the _n_ cells at _scratch_ as buffer. The sign bit is flipped, so that negative 
+    values come first */
+
+    // Histograms of all four bytes in a single pass
+    int counts[4][256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++)
+    {
+        unsigned int key = (unsigned int) values[i] ^ 0x80000000u;
+        counts[0][key & 0xff]++;
+        counts[1][key >> 8 & 0xff]++;
+        counts[2][key >> 16 & 0xff]++;
+        counts[3][key >> 24]++;
+    }
+
+    int *from = values;
+    int *to = scratch;
+    for (int pass = 0; pass < 4; pass++)
+    {
+        int shift = 8 * pass;
+
+        // Skip bytes all values share, as the pass would not move any
+        if (counts[pass][((unsigned int) from[0] ^ 0x80000000u) >> shift & 0xff] == n)
+        {
+            continue;
+        }
+
+        // Turn the counts into the first position of every byte value
+        for (int digit = 0, offset = 0; digit < 256; digit++)
+        {
+            int count = counts[pass][digit];
+            counts[pass][digit] = offset;
+            offset += count;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            unsigned int key = (unsigned int) from[i] ^ 0x80000000u;
+            to[counts[pass][key >> shift & 0xff]++] = from[i];
+        }
+
+        int *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != values)
+    {
+        memcpy(values, from, n * sizeof(int));
+    }
+}
+
+
+void sortValues(int *values, int n, int *scratch)
+{
+    /* Local function
+    EFFECT: Sorts the _n_ _values_ in ascending order: by radix sort in linear time if _scratch_ provides
+    room for _n_ values, by introsort in place if it is NULL */
+
+    if (n <= SORT_INSERTION)
+    {
+        insertionSort(values, n);
+    }
+    else if (scratch)
+    {
+        radixSort(values, scratch, n);
+    }
+    else
+    {
+        int depth = 0;
+        for (int i = n; i > 1; i >>= 1)
+        {
+            depth += 2;
+        }
+        introSort(values, n, depth);
+    }
+}
+
+
+int sortCells(Array *array)
+{
+    /* Local function
+    EFFECT: Sorts the elements of _array_ in place, directly in its cells, using a block of free memory of
+    the same length as scratch space if there is one
+    OUTPUT: 0 upon successful execution of the function; 1 if the cells of _array_ can not be accessed 
+    directly, e.g. in a sparse memory */
+
+    int *values = memRange(array->address, array->length);
+    if (!values)
+    {
+        return 1;
+    }
+
+    // The scratch block is optional, so not finding one is no error
+    int start;
+    int *scratch = NULL;
+    if (array->length > SORT_INSERTION && !memTryAlloc(array->length, &start))
+    {
+        scratch = memRange(start, array->length);
+    }
+
+    sortValues(values, array->length, scratch);
+
+    if (scratch)
+    {
+        memFreeBlock(start, array->length);
+    }
+
+    return 0;
+}
+
+
+int sortCopy(Array *array)
+{
+    /* Local function
+    EFFECT: Sorts the elements of _array_ on a copy outside of the memory and writes back those that 
+    changed, for memories whose cells can not be accessed directly
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed;
+    2 if reading or writing the elements of _array_ failed */
+
+    int n = array->length;
+    int *values = malloc(n * sizeof(int));
+    int *sorted = malloc(n * sizeof(int));
+    if (!values || !sorted)
+    {
+        fprintf(errStream(), "Error: not enough memory to sort array %s\n", array->arrayName);
+        free(values);
+        free(sorted);
+        return 1;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (memRead(array->address + i, &values[i]))
+        {
+            free(values);
+            free(sorted);
+            return 2;
+        }
+    }
+
+    memcpy(sorted, values, n * sizeof(int));
+    sortValues(sorted, n, values);
+
+    // _values_ served as scratch, so compare against the memory; unwritten cells of a sparse memory stay so
+    int error = 0;
+    for (int i = 0; i < n && !error; i++)
+    {
+        int value;
+        error = memRead(array->address + i, &value) || (value != sorted[i] && memWrite(array->address + i, sorted[i]));
+    }
+
+    free(values);
+    free(sorted);
+
+    return error ? 2 : 0;
+}
+
+
+int sortBits(Array *array)
+{
+    /* Local function
+    EFFECT: Sorts the bits of _array_ by counting the set ones and rewriting every cell with the zeros 
+    first, keeping the padding bits 0
+    OUTPUT: 0 upon successful execution of the function; 1 if reading or writing the cells of _array_ 
+    failed */
+
+    int cells = cellCount(array);
+    int ones = 0;
+    for (int i = 0; i < cells; i++)
+    {
+        int val;
+        if (memRead(array->address + i, &val))
+        {
+            return 1;
+        }
+        ones += __builtin_popcount((unsigned int) val);
+    }
+
+    int zeros = array->length - ones;
+    for (int i = 0; i < cells; i++)
+    {
+        // Bits of the cell from element _first_ on are set if they lie beyond the zeros
+        int first = i * BITS_PER_CELL;
+        unsigned int word = zeros <= first ? ~0u : zeros - first >= BITS_PER_CELL ? 0 : ~0u << (zeros - first);
+        if (array->length - first < BITS_PER_CELL)
+        {
+            word &= (1u << (array->length - first)) - 1;
+        }
+
+        if (memWrite(array->address + i, (int) word))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+unsigned int sumBlock(const int *values, int n)
+{
+    /* Local function
+    OUTPUT: The sum of the _n_ _values_, wrapping around like unsigned numbers */
+
+    int i = 0;
+    unsigned int sum = 0;
+
+#ifdef __SSE2__
+    __m128i sums = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4)
+    {
+        sums = _mm_add_epi32(sums, _mm_loadu_si128((const __m128i *) (values + i)));
+    }
+    sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 8));
+    sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 4));
+    sum = (unsigned int) _mm_cvtsi128_si32(sums);
+#endif
+
+    for (; i < n; i++)
+    {
+        sum += (unsigned int) values[i];
+    }
+
+    return sum;
+}
+
+
+unsigned int scanBlock(int *values, int n, unsigned int carry, int exclusive)
+{
+    /* Local function
+    EFFECT: Replaces the _n_ _values_ by their running totals, starting from _carry_: each by the sum of 
+    itself and all before it, or of only those before it if _exclusive_ is set. With SSE2, four values 
+    are scanned in a register at a time by adding it to itself shifted by one and by two values
+    OUTPUT: _carry_ plus the sum of the _n_ _values_, the carry into the values that follow them */
+
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128i carries = _mm_set1_epi32((int) carry);
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (values + i));
+        __m128i sums = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+        sums = _mm_add_epi32(sums, carries);
+
+        _mm_storeu_si128((__m128i *) (values + i), exclusive ? _mm_sub_epi32(sums, x) : sums);
+        carries = _mm_shuffle_epi32(sums, 0xff);
+    }
+    carry = (unsigned int) _mm_cvtsi128_si32(carries);
+#endif
+
+    for (; i < n; i++)
+    {
+        unsigned int value = (unsigned int) values[i];
+        values[i] = (int) (exclusive ? carry : carry + value);
+        carry += value;
+    }
+
+    return carry;
+}
+
+
+void scanSumChunk(void *context, int chunk)
+{
+    /* Local function
+    EFFECT: Pool task of the first pass of the prefix sum _context_, summing chunk _chunk_ */
+
+    Scan *scan = context;
+    int start = chunk * CHUNK_LENGTH;
+    int length = scan->length - start < CHUNK_LENGTH ? scan->length - start : CHUNK_LENGTH;
+
+    scan->carries[chunk] = sumBlock(scan->cells + start, length);
+}
+
+
+void scanChunk(void *context, int chunk)
+{
+    /* Local function
+    EFFECT: Pool task of the second pass of the prefix sum _context_, scanning chunk _chunk_ from the sum
+    of the chunks before it */
+
+    Scan *scan = context;
+    int start = chunk * CHUNK_LENGTH;
+    int length = scan->length - start < CHUNK_LENGTH ? scan->length - start : CHUNK_LENGTH;
+
+    scanBlock(scan->cells + start, length, scan->carries[chunk], scan->exclusive);
+}
+
+
+int scanParallel(int *cells, int length, int exclusive)
+{
+    /* Local function
+    EFFECT: Computes the prefix sum of the _length_ _cells_ in two passes over chunks on the threads of the
+    array pool, if there are enough cells to be worth it: the chunks are summed in parallel, the sums turned
+    into the carry into each chunk, and the chunks scanned in parallel
+    OUTPUT: 0 if the prefix sum was computed; 1 if it is left to the caller */
+
+    if (!arrayPool || length < PARALLEL_LENGTH)
+    {
+        return 1;
+    }
+
+    int chunks = (length + CHUNK_LENGTH - 1) / CHUNK_LENGTH;
+    Scan scan = { cells, length, malloc(chunks * sizeof(unsigned int)), exclusive };
+    if (!scan.carries)
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < chunks; i++)
+    {
+        poolSubmit(arrayPool, scanSumChunk, &scan, i);
+    }
+    poolWait(arrayPool);
+
+    unsigned int carry = 0;
+    for (int i = 0; i < chunks; i++)
+    {
+        unsigned int sum = scan.carries[i];
+        scan.carries[i] = carry;
+        carry += sum;
+    }
+
+    for (int i = 0; i < chunks; i++)
+    {
+        poolSubmit(arrayPool, scanChunk, &scan, i);
+    }
+    poolWait(arrayPool);
+
+    free(scan.carries);
+
+    return 0;
+}
+
+
+int scanElements(Array *array, int exclusive)
+{
+    /* Local function
+    EFFECT: Computes the prefix sum of _array_ element by element through the checked accessors, for bit 
+    arrays, whose elements keep the lowest bit of the sum, and memories whose cells can not be accessed 
+    directly. Elements that do not change are not written, so unwritten cells of a sparse memory stay so
+    OUTPUT: 0 upon successful execution of the function; 1 if reading or writing an element failed */
+
+    unsigned int carry = 0;
+    for (int i = 0; i < array->length; i++)
+    {
+        int value;
+        if (readElement(array, i, &value))
+        {
+            return 1;
+        }
+
+        int total = (int) (exclusive ? carry : carry + (unsigned int) value);
+        if ((array->bits ? (total & 1) != value : total != value) && writeElement(array, i, total))
+        {
+            return 1;
+        }
+        carry += (unsigned int) value;
+    }
+
+    return 0;
+}
+
+
+int checkRange(const Array *array, int start, int length)
+{
+    /* Local function
+    EFFECT: Checks whether the _length_ elements from index _start_ on lie within _array_, reporting the 
+    error if not
+    OUTPUT: 0 if the range is valid; 1 otherwise */
+
+    if (start < 0 || length <= 0 || length > array->length - start)
+    {
+        fprintf(errStream(), "Wrong Memory Access.\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int fillElements(Array *array, int value, int start, int length)
 {
     /* Local function
-    EFFECT: Computes the result of performing the operator associated with _operator_ on the array
-    with identifier _arrayName1_ and the array with identifier _arrayName2_ and writes result to 
-    the array with identifier _arrayName1_. If _onlyFirstElement_ is 1, the operation is only done 
-    on the first element of the array with identifier _arrayName1_ and the array with identifier 
-    _arrayName2_. If _onlyFirstElement_ is 0, the array with identifier _arrayName1_ and the array
-    with identifier _arrayName2_ must be the same lenght, and the operation will be done pointwise 
-    on each element of the arrays
-    OUTPUT: 0 upon successful execution of the function; 
-    1 if fetching the array with the identifier _arrayName1_ failed; 
-    2 if fetching the array with the identifier _arrayName2_ failed;
-    3 if reading, writing, or computing the result failed */
+    EFFECT: Sets the _length_ elements of _array_ from index _start_ on, a valid range, to _value_: in a 
+    single memFill() for int arrays, and for bit arrays in one for the cells the range covers entirely
+    OUTPUT: 0 upon successful execution of the function; 1 if writing failed */
 
-    Array *array1 = checkArray(arrayName1);
-    if (!array1 || array1->address < 0)
+    if (!array->bits)
+    {
+        return memFill(array->address + start, length, value) != 0;
+    }
+
+    int end = start + length;
+    for (; start < end && start % BITS_PER_CELL; start++)
+    {
+        if (writeElement(array, start, value))
+        {
+            return 1;
+        }
+    }
+
+    int cells = (end - start) / BITS_PER_CELL;
+    if (cells && memFill(array->address + start / BITS_PER_CELL, cells, value & 1 ? -1 : 0))
     {
-        fprintf(stderr, "Try to use a variable that does not exist.\n");
-        // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName1);
         return 1;
     }
 
-    Array *array2 = checkArray(arrayName2);
-    if (!array2 || array2->address < 0)
+    for (start += cells * BITS_PER_CELL; start < end; start++)
     {
-        fprintf(stderr, "Try to use a variable that does not exist.\n");
-        // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName2);
-        return 2;
+        if (writeElement(array, start, value))
+        {
+            return 1;
+        }
     }
 
-    if (executeDualArrayOperator(array1, array2, operator, onlyFirstElement))
+    return 0;
+}
+
+
+int copyElements(Array *to, Array *from, int start1, int start2, int length)
+{
+    /* Local function
+    EFFECT: Copies the _length_ elements of _from_ from index _start2_ on to those of _to_ from index 
+    _start1_ on, both valid ranges, which may overlap: in a single memMove() between int arrays, element 
+    by element otherwise, backwards if the source lies before an overlapping destination
+    OUTPUT: 0 upon successful execution of the function; 1 if reading or writing failed */
+
+    if (!to->bits && !from->bits)
     {
-        return 3;
+        return memMove(to->address + start1, from->address + start2, length) != 0;
+    }
+
+    int step = to == from && start1 > start2 ? -1 : 1;
+    for (int k = 0, i = step > 0 ? 0 : length - 1; k < length; k++, i += step)
+    {
+        int value;
+        if (readElement(from, start2 + i, &value) || writeElement(to, start1 + i, value))
+        {
+            return 1;
+        }
     }
 
     return 0;
@@ -306,16 +1168,37 @@ int freeAll(void)
 }
 
 
+int resetAll(void)
+{
+    // Drop the identifiers; their memory is released at once by resetting it
+    while (arrays)
+    {
+        Array *next = arrays->next;
+        free(arrays->arrayName);
+        free(arrays);
+        arrays = next;
+    }
+
+    if (memReset())
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
 int assign(const char *arrayName, int value)
 {
-    int address = fetchAddress(arrayName, 0);
+    int bit;
+    int address = fetchAddress(arrayName, 0, &bit);
     if (address < 0)
     {
         // fprintf(stderr, "Error: fetching address of the array with identifier %s failed\n", arrayName);       
         return 1;
     }
 
-    if (memWrite(address, value))
+    if (bit >= 0 ? writeBit(address, bit, value) : memWrite(address, value))
     {
         // fprintf(stderr, "Error: writing to address %d of the array with identifier %s failed\n", address, arrayName);     
         return 2;
@@ -327,14 +1210,17 @@ int assign(const char *arrayName, int value)
 
 int increase(const char *arrayName, int index)
 {
-    int address = fetchAddress(arrayName, index);
+    int bit;
+    int address = fetchAddress(arrayName, index, &bit);
     if (address < 0)
     {
         // fprintf(stderr, "Error: fetching address of the array with identifier %s failed\n", arrayName);     
         return 1;
     }
 
-    if (memInc(address))
+    // Adding 1 to a bit flips it
+    int value;
+    if (bit >= 0 ? readBit(address, bit, &value) || writeBit(address, bit, !value) : memInc(address))
     {
         // fprintf(stderr, "Error: increasing the value of the address %d of the array with identifier %s failed\n", address, arrayName);    
         return 2;
@@ -346,14 +1232,17 @@ int increase(const char *arrayName, int index)
 
 int decrease(const char *arrayName, int index)
 {
-    int address = fetchAddress(arrayName, index);
+    int bit;
+    int address = fetchAddress(arrayName, index, &bit);
     if (address < 0)
     {
         // fprintf(stderr, "Error: fetching address of the array with identifier %s failed\n", arrayName);  
         return 1;
     }
 
-    if (memDec(address))
+    // Subtracting 1 from a bit flips it
+    int value;
+    if (bit >= 0 ? readBit(address, bit, &value) || writeBit(address, bit, !value) : memDec(address))
     {
         // fprintf(stderr, "Error: decreasing the value of the address %d of the array with identifier %s failed\n", address, arrayName);    
         return 2;
@@ -365,16 +1254,74 @@ int decrease(const char *arrayName, int index)
 
 int allocate(const char *arrayName, int length)
 {
+    return allocateArray(arrayName, length, 0);
+}
+
+
+int allocateBits(const char *arrayName, int length)
+{
+    return allocateArray(arrayName, length, 1);
+}
+
+
+int reallocate(const char *arrayName, int length)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    if (length <= 0)
+    {
+        fprintf(errStream(), "Error: invalid length %d of array\n", length);
+        return 2;
+    }
+
+    int cells = array->bits ? (length - 1) / BITS_PER_CELL + 1 : length;
+
+    // Bits past the end of a shrunk bit array are cleared, as whole cells are counted and combined
+    if (array->bits && length < array->length && length % BITS_PER_CELL)
+    {
+        int cell;
+        int address = array->address + cells - 1;
+        unsigned int mask = (1u << length % BITS_PER_CELL) - 1;
+        if (memRead(address, &cell) || memWrite(address, (int) ((unsigned int) cell & mask)))
+        {
+            return 3;
+        }
+    }
+
+    int address;
+    if (memRealloc(array->address, cellCount(array), cells, &address))
+    {
+        return 3;
+    }
+
+    array->address = address;
+    array->length = length;
+
+    return 0;
+}
+
+
+int allocateArray(const char *arrayName, int length, int bits)
+{
+    /* Local function
+    EFFECT: Allocates an array as described at allocate(), of single bits if _bits_ is set
+    OUTPUT: As allocate() */
+
     if (length <= 0)
     {
-        fprintf(stderr, "Error: invalid length %d of array\n", length);
+        fprintf(errStream(), "Error: invalid length %d of array\n", length);
         return 1;
     }
 
     // Check that _arrayName_ doesn't already exist
     if (checkArray(arrayName))
     {
-        fprintf(stderr, "Error: array with identifier %s already exists\n", arrayName);
+        fprintf(errStream(), "Error: array with identifier %s already exists\n", arrayName);
         return 2;
     }
 
@@ -382,7 +1329,7 @@ int allocate(const char *arrayName, int length)
     Array *newElement = malloc(sizeof(Array));
     if (!newElement)
     {
-        fprintf(stderr, "Error: creating a new element to store array identifier %s failed\n", arrayName);
+        fprintf(errStream(), "Error: creating a new element to store array identifier %s failed\n", arrayName);
         return 3;
     }
 
@@ -392,15 +1339,16 @@ int allocate(const char *arrayName, int length)
     if (!newElement->arrayName)
     {
         free(newElement);
-        fprintf(stderr, "Error: an error occured while allocating memory to store identifier %s\n", arrayName);
+        fprintf(errStream(), "Error: an error occured while allocating memory to store identifier %s\n", arrayName);
         return 4;
     }
 
     newElement->length = length;
+    newElement->bits = bits;
     newElement->next = NULL;
 
     // Allocate space in memory for array and store its address
-    if (memAlloc(length, &(newElement->address)))
+    if (memAlloc(cellCount(newElement), &(newElement->address)))
     {
         free(newElement->arrayName);
         free(newElement);
@@ -429,7 +1377,8 @@ int allocate(const char *arrayName, int length)
 
 int printCell(const char *arrayName, int index)
 {
-    int address = fetchAddress(arrayName, index);
+    int bit;
+    int address = fetchAddress(arrayName, index, &bit);
     if (address < 0)
     {
         // fprintf(stderr, "Error: fetching address of the array with identifier %s failed\n", arrayName);    
@@ -437,13 +1386,13 @@ int printCell(const char *arrayName, int index)
     }
 
     int val;
-    if (memRead(address, &val))
+    if (bit >= 0 ? readBit(address, bit, &val) : memRead(address, &val))
     {
         // fprintf(stderr, "Error: reading the address %d of the array with identifier %s failed\n", address, arrayName);
         return 2;
     }
 
-    printf("%d\n", val);
+    fprintf(outStream(), "%d\n", val);
 
     return 0;
 }
@@ -528,25 +1477,252 @@ int printArray(const char *arrayName)
     Array *array = checkArray(arrayName);
     if (!array)
     {
-        fprintf(stderr, "Try to use a variable that does not exist.\n");
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
         // fprintf(stderr, "Error: no array with identifier %s exist\n", arrayName);
         return 1;
     }
 
-    printf("[ ");
+    fprintf(outStream(), "[ ");
     for (int i = 0, n = array->length; i < n; i++)
     {
         int val;
-        if (memRead(array->address + i, &val))
+        if (readElement(array, i, &val))
         {
             // fprintf(stderr, "Error: reading the address %d of the array with identifier %s failed\n", array->address + i, arrayName);
             return 2;
         }
 
-        printf("%d ", val);
+        fprintf(outStream(), "%d ", val);
     }
-    printf("]\n");
+    fprintf(outStream(), "]\n");
     
     return 0;
 }
 
+
+int countArray(const char *arrayName)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    // Bit arrays are counted a cell at a time, their padding bits being 0
+    int count = 0;
+    for (int i = 0, n = cellCount(array); i < n; i++)
+    {
+        int val;
+        if (memRead(array->address + i, &val))
+        {
+            return 2;
+        }
+
+        count += array->bits ? __builtin_popcount((unsigned int) val) : val != 0;
+    }
+    fprintf(outStream(), "%d\n", count);
+
+    return 0;
+}
+
+
+int sortArray(const char *arrayName)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    if (array->bits)
+    {
+        return sortBits(array) ? 2 : 0;
+    }
+
+    if (!sortCells(array))
+    {
+        return 0;
+    }
+
+    return sortCopy(array) ? 2 : 0;
+}
+
+
+int scanArray(const char *arrayName, int exclusive)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    int *cells = array->bits ? NULL : memRange(array->address, array->length);
+    if (!cells)
+    {
+        return scanElements(array, exclusive) ? 2 : 0;
+    }
+
+    if (scanParallel(cells, array->length, exclusive))
+    {
+        scanBlock(cells, array->length, 0, exclusive);
+    }
+
+    return 0;
+}
+
+
+int fillArray(const char *arrayName, int value)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    return fillElements(array, value, 0, array->length) ? 3 : 0;
+}
+
+
+int fillRange(const char *arrayName, int value, int start, int length)
+{
+    Array *array = checkArray(arrayName);
+    if (!array)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    if (checkRange(array, start, length))
+    {
+        return 2;
+    }
+
+    return fillElements(array, value, start, length) ? 3 : 0;
+}
+
+
+int copyArray(const char *arrayName1, const char *arrayName2)
+{
+    Array *array1 = checkArray(arrayName1);
+    Array *array2 = checkArray(arrayName2);
+    if (!array1 || !array2)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    if (checkRange(array1, 0, array2->length))
+    {
+        return 2;
+    }
+
+    return copyElements(array1, array2, 0, 0, array2->length) ? 3 : 0;
+}
+
+
+int copyRange(const char *arrayName1, const char *arrayName2, int start1, int start2, int length)
+{
+    Array *array1 = checkArray(arrayName1);
+    Array *array2 = checkArray(arrayName2);
+    if (!array1 || !array2)
+    {
+        fprintf(errStream(), "Try to use a variable that does not exist.\n");
+        return 1;
+    }
+
+    if (checkRange(array1, start1, length) || checkRange(array2, start2, length))
+    {
+        return 2;
+    }
+
+    return copyElements(array1, array2, start1, start2, length) ? 3 : 0;
+}
+
+
+Array *findArray(const char *arrayName)
+{
+    return checkArray(arrayName);
+}
+
+
+void assignUnchecked(Array *array, int value)
+{
+    memWriteUnchecked(array->address, value);
+}
+
+
+void increaseUnchecked(Array *array, int index)
+{
+    memIncUnchecked(array->address + index);
+}
+
+
+void decreaseUnchecked(Array *array, int index)
+{
+    memDecUnchecked(array->address + index);
+}
+
+
+void printCellUnchecked(Array *array, int index)
+{
+    fprintf(outStream(), "%d\n", memReadUnchecked(array->address + index));
+}
+
+
+void printArrayUnchecked(Array *array)
+{
+    fprintf(outStream(), "[ ");
+    for (int i = 0, n = array->length; i < n; i++)
+    {
+        fprintf(outStream(), "%d ", memReadUnchecked(array->address + i));
+    }
+    fprintf(outStream(), "]\n");
+}
+
+
+void dualArrayOperatorUnchecked(Array *array1, Array *array2, char operator, int onlyFirstElement)
+{
+    if (!onlyFirstElement && !pointwiseParallel(array1, array2, operator))
+    {
+        return;
+    }
+
+    int n = onlyFirstElement ? 1 : array1->length;
+    for (int i = 0; i < n; i++)
+    {
+        int result = 0;
+        applyOperator(memReadUnchecked(array1->address + i), memReadUnchecked(array2->address + i), operator, &result);
+        memWriteUnchecked(array1->address + i, result);
+    }
+}
+
+
+int *arrayCells(Array *array)
+{
+    return memCellPointer(array->address);
+}
+
+
+int arrayLength(Array *array)
+{
+    return array->length;
+}
+
+
+Array *swapArrays(Array *list)
+{
+    Array *previous = arrays;
+    arrays = list;
+
+    return previous;
+}
+
+
+void setArrayPool(Pool *pool)
+{
+    arrayPool = pool;
+}
@@ -1,6 +1,11 @@
 #ifndef FUNCTIONS_H
 #define FUNCTIONS_H
 
+/* Handle to an allocated array. Valid until the array is freed */
+typedef struct Array Array;
+
+struct Pool;
+
 /* EFFECT: Initializes the memory. Needs to be called before any other function
 OUTPUT: 0 upon successful execution of the function; 1 if memory initialization failed */
 int init(void);
@@ -9,6 +14,11 @@ int init(void);
 OUTPUT: 0 upon successful execution of the function; 1 if freeing memory failed*/
 int freeAll(void);
 
+/* EFFECT: Removes all arrays and identifiers but keeps the memory initialized, so another program can 
+run without calling init() again. Faster than freeAll() followed by init()
+OUTPUT: 0 upon successful execution of the function; 1 if resetting the memory failed */
+int resetAll(void);
+
 /* EFFECT: Assigns the value _value_ to the first element of the array with identifier  _arrayName_ 
 OUTPUT: 0 upon successful execution of the function; 1 if fetching memory address of the array with 
 identifier _arrayName_ failed; 2 if writing to the address of the first element of the array with 
@@ -36,6 +46,19 @@ OUTPUT: 0 upon successful execution of the function;
 5 if allocating memory for the array failed */
 int allocate(const char *arrayName, int length);
 
+/* EFFECT: Allocates memory for an array of _length_ single bits with identifier _arrayName_, packed 32 to
+a memory cell. Its elements are 0 or 1: values written to it keep only their lowest bit, so increasing 
+or decreasing an element flips it, and And and Xor of two bit arrays run on whole cells at once
+OUTPUT: As allocate() */
+int allocateBits(const char *arrayName, int length);
+
+/* EFFECT: Resizes the array with identifier _arrayName_ to _length_ elements of the same kind, keeping its
+first elements; elements added are 0. The array grows in place into free memory right after it if 
+possible, and is moved otherwise
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+2 if invalid length (_length_ <= 0) was supplied; 3 if resizing the memory of the array failed */
+int reallocate(const char *arrayName, int length);
+
 /* EFFECT: Prints element with index _index_ of the array with identifier _arrayName_
 OUTPUT: 0 upon successful execution of the function; 1 if fetching memory address of the array with 
 identifier _arrayName_ failed; 2 if reading the value of the address of the first element of the 
@@ -85,4 +108,83 @@ OUTPUT: 0 upon successful execution of the function; 1 if no array with identifi
 2 if reading the contents of the array with identifier _arrayName_ failed */
 int printArray(const char *arrayName);
 
+/* EFFECT: Prints the number of non-zero elements of the array with identifier _arrayName_; for bit 
+arrays the number of set bits, counted a cell at a time
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+2 if reading the contents of the array with identifier _arrayName_ failed */
+int countArray(const char *arrayName);
+
+/* EFFECT: Sorts the elements of the array with identifier _arrayName_ in ascending order, in place. Uses a
+radix sort in linear time when a free block of memory as long as the array is available as scratch space,
+and an introsort otherwise
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+2 if reading or writing the contents of the array with identifier _arrayName_ failed */
+int sortArray(const char *arrayName);
+
+/* EFFECT: Replaces every element of the array with identifier _arrayName_ by the running total up to it:
+the sum of itself and all elements before it (inclusive), or of only those before it if _exclusive_ is 
+set, so the first becomes 0. Sums wrap around on overflow; elements of bit arrays keep their lowest bit,
+the parity of the sum. Vectorised with SSE2 where available, and computed in two passes over chunks on
+the array pool (see setArrayPool()) for large arrays
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+2 if reading or writing the contents of the array with identifier _arrayName_ failed */
+int scanArray(const char *arrayName, int exclusive);
+
+/* EFFECT: Sets all elements of the array with identifier _arrayName_ to _value_ at once
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+3 if writing to the array failed */
+int fillArray(const char *arrayName, int value);
+
+/* EFFECT: Sets the _length_ elements of the array with identifier _arrayName_ from index _start_ on to 
+_value_ at once, after checking that they all lie within the array
+OUTPUT: 0 upon successful execution of the function; 1 if no array with identifier _arrayName_ exists;
+2 if the range is empty or not within the array; 3 if writing to the array failed */
+int fillRange(const char *arrayName, int value, int start, int length);
+
+/* EFFECT: Copies all elements of the array with identifier _arrayName2_ to the first elements of the array
+with identifier _arrayName1_ at once
+OUTPUT: 0 upon successful execution of the function; 1 if either array does not exist; 2 if the array 
+with identifier _arrayName2_ is longer than the one with identifier _arrayName1_; 3 if copying failed */
+int copyArray(const char *arrayName1, const char *arrayName2);
+
+/* EFFECT: Copies the _length_ elements of the array with identifier _arrayName2_ from index _start2_ on to 
+those of the array with identifier _arrayName1_ from index _start1_ on at once, after checking that both 
+ranges lie within their arrays. The ranges may overlap when both identifiers are the same
+OUTPUT: 0 upon successful execution of the function; 1 if either array does not exist; 2 if a range is 
+empty or not within its array; 3 if copying failed */
+int copyRange(const char *arrayName1, const char *arrayName2, int start1, int start2, int length);
+
+/* EFFECT: Looks up the array with identifier _arrayName_ without reporting an error if it does not exist
+OUTPUT: Handle of the array with identifier _arrayName_; NULL if no such array exists */
+Array *findArray(const char *arrayName);
+
+/* Unchecked variants of the functions above, operating on a handle returned by findArray(). They skip
+the identifier lookup as well as all bounds and allocation checks, and can therefore not fail.
+PRE: _array_ (and _array2_) are live, _index_ is within the range of _array_, and for the point-wise
+operators (_onlyFirstElement_ is 0) both arrays have the same length */
+void assignUnchecked(Array *array, int value);
+void increaseUnchecked(Array *array, int index);
+void decreaseUnchecked(Array *array, int index);
+void printCellUnchecked(Array *array, int index);
+void printArrayUnchecked(Array *array);
+void dualArrayOperatorUnchecked(Array *array1, Array *array2, char operator, int onlyFirstElement);
+
+/* EFFECT: Gives direct access to the cells of the array _array_, e.g. for native code
+OUTPUT: Pointer to the first element of _array_, valid until _array_ is freed */
+int *arrayCells(Array *array);
+
+/* OUTPUT: The number of elements of the array _array_ */
+int arrayLength(Array *array);
+
+/* EFFECT: Makes _list_, as returned by an earlier call, the arrays of the calling thread, so that one 
+thread can run several independent sets of arrays in turn together with memSwap() (see memory.h). NULL 
+leaves the thread without arrays
+OUTPUT: The arrays the calling thread had before */
+Array *swapArrays(Array *list);
+
+/* EFFECT: Splits pointwise operations (And, Xor) on large arrays into chunks computed in parallel on the 
+threads of _pool_ (see pool.h); arrays below the threshold stay on the calling thread. NULL computes all 
+operations on the calling thread. Shared by all threads, so it is set before any other thread starts */
+void setArrayPool(struct Pool *pool);
+
 #endif
@@ -2,10 +2,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include "functions.h" 
+#include "interpreter.h"
+#include "output.h"
 
 // Local functions
+int parseInt(const char* str, int* num);
 int makeInt(const char* str, int* num);
-int callCommand(const char* opName, const char* parameter1, const char* parameter2);
+int callCommand(const char* opName, const char* parameter1, const char* parameter2, char** extra, int extras);
+int nextToken(const char **cursor, const char *end, Token *token);
+int tokenIs(const Token *token, const char *word);
+int parseIntToken(const Token *token, int* num);
 	
 int interpretLine(char *line)
 {	
@@ -20,19 +26,30 @@ int interpretLine(char *line)
 	char* parameter1 = strtok(NULL, " ");
 	if (!parameter1)
 	{
-		fprintf(stderr, "Error: no parameter supplied for operator %s\n", opName);
+		fprintf(errStream(), "Error: no parameter supplied for operator %s\n", opName);
 		return 1;
 	}
 
 	char* parameter2  = strtok(NULL, " ");
 
-	if (strtok(NULL, " "))
+	// Only some operators take further parameters: Mal the word bit, to allocate an array of single
+	// bits, and Fil and Cpy the range they work on
+	char* extra[3];
+	int extras = 0;
+	while (extras < 3 && (extra[extras] = strtok(NULL, " ")))
 	{
-		fprintf(stderr, "Error: too many parameters supplied\n");
+		extras++;
+	}
+
+	int allowed = !strcmp(opName, "Mal") ? extras == 1 && !strcmp(extra[0], "bit")
+	              : !strcmp(opName, "Fil") ? extras == 2 : !strcmp(opName, "Cpy") && extras == 3;
+	if ((extras && !allowed) || strtok(NULL, " "))
+	{
+		fprintf(errStream(), "Error: too many parameters supplied\n");
 		return 2;
 	}
 
-	if (callCommand(opName, parameter1, parameter2))
+	if (callCommand(opName, parameter1, parameter2, extra, extras))
 	{
 		return 3;
 	}
@@ -41,10 +58,10 @@ int interpretLine(char *line)
 }
 
 
-int makeInt(const char* str, int* num)
+int parseInt(const char* str, int* num)
 {
 	/* Local function 
-    EFFECT: Turns a string containing numbers into an integer number of base-10
+    EFFECT: Turns a string containing numbers into an integer number of base-10 without reporting errors
     OUTPUT: 0 upon successful execution; 1 if the string contains characters that are not numbers */
 
 	char* endptr;
@@ -53,7 +70,6 @@ int makeInt(const char* str, int* num)
 	// If _endptr_ is a non-empty string, then _str_ must have contained non-number characters
     if (str == endptr || *endptr != '\0')
     {
-        fprintf(stderr, "Error: invalid parameter %s. Must be a number\n", str);
         return 1;
     }
 
@@ -61,10 +77,27 @@ int makeInt(const char* str, int* num)
 }
 
 
-int callCommand(const char* opName, const char* parameter1, const char* parameter2)
+int makeInt(const char* str, int* num)
+{
+	/* Local function 
+    EFFECT: Turns a string containing numbers into an integer number of base-10
+    OUTPUT: 0 upon successful execution; 1 if the string contains characters that are not numbers */
+
+    if (parseInt(str, num))
+    {
+        fprintf(errStream(), "Error: invalid parameter %s. Must be a number\n", str);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int callCommand(const char* opName, const char* parameter1, const char* parameter2, char** extra, int extras)
 {
 	/* Local function 
-    EFFECT: Calls a function based on _opName_ passing _parameter1_ and _parameter2_. 
+    EFFECT: Calls a function based on _opName_ passing _parameter1_ and _parameter2_, and the _extras_ 
+	further parameters in _extra_, which interpretLine() allows only where the operator takes them. 
 	Checks whether correct amount of parameters have been passed.
     OUTPUT: 0 upon successful execution; 
 	1 if an incorrect number of parameters for the function identified with _opName_ have been passed;
@@ -75,14 +108,14 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 
 	if (!opName)
 	{
-	    fprintf(stderr, "Error: missing operator\n");
+	    fprintf(errStream(), "Error: missing operator\n");
     	return 4;	
 	}
 
 	if (!strcmp(opName, "Ass")){
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -103,7 +136,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -124,7 +157,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -145,7 +178,28 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+			return 1;
+		}
+
+		int length;
+		if (makeInt(parameter2, &length))
+		{
+			return 2;
+		}
+
+		if (extras ? allocateBits(parameter1, length) : allocate(parameter1, length))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+	else if (!strcmp(opName, "Rea"))
+	{
+		if (!parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -155,7 +209,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 			return 2;
 		}
 
-		if (allocate(parameter1, length))
+		if (reallocate(parameter1, length))
 		{
 			return 3;
 		}
@@ -166,7 +220,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -187,7 +241,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -202,7 +256,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -217,7 +271,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -232,7 +286,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -247,7 +301,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (!parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
 			return 1;
 		}
 
@@ -262,7 +316,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
 			return 1;
 		}
 
@@ -277,7 +331,7 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 	{
 		if (parameter2)
 		{
-            fprintf(stderr, "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
+            fprintf(errStream(), "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
 			return 1;
 		}
 
@@ -288,17 +342,344 @@ int callCommand(const char* opName, const char* parameter1, const char* paramete
 
         return 0;
 	}
+	else if (!strcmp(opName, "Cnt"))
+	{
+		if (parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
+			return 1;
+		}
+
+		if (countArray(parameter1))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+	else if (!strcmp(opName, "Srt"))
+	{
+		if (parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
+			return 1;
+		}
+
+		if (sortArray(parameter1))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+	else if (!strcmp(opName, "Fil"))
+	{
+		if (!parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+			return 1;
+		}
+
+		int value;
+		if (makeInt(parameter2, &value))
+		{
+			return 2;
+		}
+
+		if (extras)
+		{
+			int start;
+			int length;
+			if (makeInt(extra[0], &start) || makeInt(extra[1], &length))
+			{
+				return 2;
+			}
+
+			if (fillRange(parameter1, value, start, length))
+			{
+				return 3;
+			}
+		}
+		else if (fillArray(parameter1, value))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+	else if (!strcmp(opName, "Cpy"))
+	{
+		if (!parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 2 parameters, but only 1 was supplied\n", opName);
+			return 1;
+		}
+
+		if (extras)
+		{
+			int start1;
+			int start2;
+			int length;
+			if (makeInt(extra[0], &start1) || makeInt(extra[1], &start2) || makeInt(extra[2], &length))
+			{
+				return 2;
+			}
+
+			if (copyRange(parameter1, parameter2, start1, start2, length))
+			{
+				return 3;
+			}
+		}
+		else if (copyArray(parameter1, parameter2))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+	else if (!strcmp(opName, "Scn") || !strcmp(opName, "Scx"))
+	{
+		if (parameter2)
+		{
+            fprintf(errStream(), "Error: operator %s requires 1 parameter, but 2 were supplied\n", opName);
+			return 1;
+		}
 
-    fprintf(stderr, "Error: unknown operator %s\n", opName);
+		if (scanArray(parameter1, opName[2] == 'x'))
+		{
+			return 3;
+		}
+
+        return 0;
+	}
+
+    fprintf(errStream(), "Error: unknown operator %s\n", opName);
 	return 4;
 }
 
 
+int nextToken(const char **cursor, const char *end, Token *token)
+{
+	/* Local function 
+    EFFECT: Stores in _token_ the next part of the text between _cursor_ and _end_ delimited by ' ',
+	as strtok() would return it, and advances _cursor_ past it
+    OUTPUT: 1 if a token was found; 0 if only delimiters are left */
+
+	const char *c = *cursor;
+	while (c < end && *c == ' ')
+	{
+		c++;
+	}
+
+	if (c == end)
+	{
+		*cursor = c;
+		return 0;
+	}
+
+	token->text = c;
+	while (c < end && *c != ' ')
+	{
+		c++;
+	}
+	token->length = c - token->text;
+	*cursor = c;
+
+	return 1;
+}
+
+
+int tokenIs(const Token *token, const char *word)
+{
+	/* Local function 
+    EFFECT: Compares _token_ with the NUL-terminated _word_
+    OUTPUT: 1 if they are equal; 0 otherwise */
+
+	return strlen(word) == token->length && !memcmp(token->text, word, token->length);
+}
+
+
+int parseIntToken(const Token *token, int* num)
+{
+	/* Local function 
+    EFFECT: Turns _token_ into an integer number exactly as parseInt() does for the same text
+    OUTPUT: 0 upon successful execution; 1 if the token contains characters that are not numbers;
+	2 if allocating memory failed */
+
+	char small[32];
+	char *text = small;
+	if (token->length >= sizeof(small))
+	{
+		text = malloc(token->length + 1);
+		if (!text)
+		{
+			return 2;
+		}
+	}
+
+	memcpy(text, token->text, token->length);
+	text[token->length] = '\0';
+
+	int error = parseInt(text, num);
+	if (text != small)
+	{
+		free(text);
+	}
+
+	return error;
+}
+
+
+int decodeLine(const char *line, size_t length, Instruction *instruction, Token *name1, Token *name2,
+               int32_t *operands)
+{
+	// Like strtok(), stop at an embedded NUL character
+	const char *end = memchr(line, '\0', length);
+	if (!end)
+	{
+		end = line + length;
+	}
+
+	// Split the line exactly as interpretLine() does
+	Token opName;
+	Token parameter1;
+	Token parameter2;
+	Token extra[4];
+	if (!nextToken(&line, end, &opName))
+	{
+		return 1;
+	}
+
+	int hasParameter1 = nextToken(&line, end, &parameter1);
+	int hasParameter2 = nextToken(&line, end, &parameter2);
+	int extras = 0;
+	while (extras < 4 && nextToken(&line, end, &extra[extras]))
+	{
+		extras++;
+	}
+
+	int bits = extras == 1 && tokenIs(&opName, "Mal") && tokenIs(&extra[0], "bit");
+	int ranged = (tokenIs(&opName, "Fil") && extras == 2) || (tokenIs(&opName, "Cpy") && extras == 3);
+	if (!hasParameter1 || (extras && !bits && !ranged))
+	{
+		return 2;
+	}
+
+	// Operators taking an identifier and a number
+	static const char *numberOps[] = { "Ass", "Inc", "Dec", "Mal", "Pri", "Rea" };
+	static const int numberCodes[] = { OP_ASS, OP_INC, OP_DEC, OP_MAL, OP_PRI, OP_REA };
+
+	// Operators taking two identifiers
+	static const char *dualOps[] = { "Add", "Sub", "Mul", "And", "Xor" };
+	static const int dualCodes[] = { OP_ADD, OP_SUB, OP_MUL, OP_AND, OP_XOR };
+
+	*name1 = parameter1;
+	name2->text = NULL;
+	name2->length = 0;
+	instruction->value = 0;
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (tokenIs(&opName, numberOps[i]))
+		{
+			if (!hasParameter2)
+			{
+				return 2;
+			}
+
+			int error = parseIntToken(&parameter2, &instruction->value);
+			if (error)
+			{
+				return error == 1 ? 2 : 3;
+			}
+
+			instruction->op = bits ? OP_BIT : numberCodes[i];
+			return 0;
+		}
+	}
+
+	for (int i = 0; i < 5; i++)
+	{
+		if (tokenIs(&opName, dualOps[i]))
+		{
+			if (!hasParameter2)
+			{
+				return 2;
+			}
+
+			instruction->op = dualCodes[i];
+			*name2 = parameter2;
+			return 0;
+		}
+	}
+
+	// Fil and Cpy keep their numbers in _operands_, with a length of -1 for a whole array
+	if (tokenIs(&opName, "Fil") || tokenIs(&opName, "Cpy"))
+	{
+		if (!hasParameter2)
+		{
+			return 2;
+		}
+
+		int fill = opName.text[0] == 'F';
+		Token *numbers[3] = { &parameter2, &extra[0], &extra[1] };
+		if (!fill)
+		{
+			*name2 = parameter2;
+			numbers[0] = &extra[0];
+			numbers[1] = &extra[1];
+			numbers[2] = &extra[2];
+		}
+
+		operands[0] = 0;
+		operands[1] = 0;
+		operands[2] = -1;
+		for (int i = 0; i < (fill ? 1 : 0) + (ranged ? 2 + !fill : 0); i++)
+		{
+			int error = parseIntToken(numbers[i], &operands[i]);
+			if (error)
+			{
+				return error == 1 ? 2 : 3;
+			}
+		}
+
+		// Ranges of no elements fail, and -1 marks a whole array; let interpretLine() report the error
+		if (ranged && operands[2] <= 0)
+		{
+			return 2;
+		}
+
+		instruction->op = fill ? OP_FIL : OP_CPY;
+		return 0;
+	}
+
+	// Operators taking a single identifier
+	static const char *singleOps[] = { "Fre", "Pra", "Cnt", "Srt", "Scn", "Scx" };
+	static const int singleCodes[] = { OP_FRE, OP_PRA, OP_CNT, OP_SRT, OP_SCN, OP_SCX };
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (tokenIs(&opName, singleOps[i]))
+		{
+			if (hasParameter2)
+			{
+				return 2;
+			}
+
+			instruction->op = singleCodes[i];
+			return 0;
+		}
+	}
+
+	return 2;
+}
+
+
 int initializeProgram(void)
 {
 	if (init())
 	{
-		fprintf(stderr, "Error: initializing program failed\n");
+		fprintf(errStream(), "Error: initializing program failed\n");
 		return 1;
 	}
 
@@ -310,10 +691,21 @@ int terminateProgram(void)
 {
 	if (freeAll())
 	{
-		fprintf(stderr, "Error: terminating program failed\n");
+		fprintf(errStream(), "Error: terminating program failed\n");
 		return 1;
 	}
 
 	return 0;
 }
 
+
+int resetProgram(void)
+{
+	if (resetAll())
+	{
+		fprintf(errStream(), "Error: resetting program failed\n");
+		return 1;
+	}
+
+	return 0;
+}
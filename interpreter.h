@@ -1,6 +1,10 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "program.h"
+
 /* EFFECT: Interprets line with format "{Operator} {paramater1} {parameter2}" (note the whitespace 
 as delimiter), where parameter2 is optional based on the chosen operator. Executes the chosen 
 operater with supplied parameters. If _line_ is NULL, it returns 0.
@@ -14,6 +18,11 @@ Dec {string arrayName} {int index} - decrease by 1 the element with index _index
 with identifier _arrayName_
 Mal {string arrayName} {int length} - allocates memory for an array of length _length_ with 
 identifier _arrayName_
+Mal {string arrayName} {int length} bit - allocates memory for an array of _length_ single bits with
+identifier _arrayName_, packed 32 to a memory cell; its elements only keep the lowest bit of what is 
+stored in them
+Rea {string arrayName} {int length} - resize the array with identifier _arrayName_ to _length_ elements, 
+keeping its first elements; elements added are 0
 Pri {string arrayName} {int index} - print the value of the element with index _index_ of the 
 array with identifier _arrayName_
 Add {string arrayName1} {string arrayName2} - add the value of the first element of the array with 
@@ -34,11 +43,44 @@ the first element of the array with identifier _arrayName1_ and the value of the
 Fre {string arrayName} - free the space allocated for the array with identifier _arrayName_
 Pra {string arrayName} - print the content of the array with identifier _arrayName_ in the form 
 "[ x x x ]" (for an array of length 3, where x is a number)
+Cnt {string arrayName} - print the number of non-zero elements of the array with identifier _arrayName_
+Srt {string arrayName} - sort the elements of the array with identifier _arrayName_ in ascending order
+Scn {string arrayName} - replace every element of the array with identifier _arrayName_ by the sum of 
+itself and all elements before it (inclusive prefix sum)
+Scx {string arrayName} - replace every element of the array with identifier _arrayName_ by the sum of 
+all elements before it (exclusive prefix sum)
+Fil {string arrayName} {int number} - set all elements of the array with identifier _arrayName_ to _number_
+Fil {string arrayName} {int number} {int start} {int length} - set the _length_ elements of the array with 
+identifier _arrayName_ from index _start_ on to _number_
+Cpy {string arrayName1} {string arrayName2} - copy all elements of the array with identifier _arrayName2_ to 
+the first elements of the array with identifier _arrayName1_
+Cpy {string arrayName1} {string arrayName2} {int start1} {int start2} {int length} - copy the _length_ 
+elements of the array with identifier _arrayName2_ from index _start2_ on to the array with identifier 
+_arrayName1_ from index _start1_ on; the ranges may overlap
 
-OUTPUT: 0 upon successful execution of the function; 1 if more than 2 parameters were supplied; 
+OUTPUT: 0 upon successful execution of the function; 1 if more than 2 parameters were supplied, 
+other than the word bit of Mal and the ranges of Fil and Cpy; 
 2 if executing the operator failed */
 int interpretLine(char* line);
 
+/* View of a part of a line. The text is not NUL-terminated */
+typedef struct Token
+{
+    const char *text;
+    size_t length;
+} Token;
+
+/* EFFECT: Parses the _length_ characters at _line_ (without trailing newline) in the same way as 
+interpretLine(), but without modifying the line, executing it, or printing errors. On success the 
+operator and the number parameter are stored in _instruction_->op and _instruction_->value, and 
+_name1_ and _name2_ are set to the identifiers inside _line_ (_name2_ has NULL text for operators 
+that take a single identifier). The three numbers of OP_FIL and OP_CPY are stored in _operands_ 
+instead (see program.h). Lines may be of any length
+OUTPUT: 0 upon successful execution of the function; 1 if _line_ is empty; 2 if interpretLine() 
+would report an error for _line_ before executing anything; 3 if allocating memory failed */
+int decodeLine(const char *line, size_t length, Instruction *instruction, Token *name1, Token *name2,
+               int32_t *operands);
+
 /* EFFECT: Initializes the program. Needs to be called before any other function
 OUTPUT: 0 upon successful execution of the function; 1 if initialization failed */
 int initializeProgram(void);
@@ -47,4 +89,8 @@ int initializeProgram(void);
 OUTPUT: 0 upon successful execution of the function; 1 if freeing memory failed */
 int terminateProgram(void);
 
+/* EFFECT: Frees all arrays and identifiers, leaving the program initialized for the next program
+OUTPUT: 0 upon successful execution of the function; 1 if resetting failed */
+int resetProgram(void);
+
 #endif
@@ -0,0 +1,275 @@
+#define _GNU_SOURCE         // fopencookie()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "analysis.h"
+#include "functions.h"
+#include "ipwash.h"
+#include "jit.h"
+#include "memory.h"
+#include "output.h"
+#include "program.h"
+
+/* The state of one interpreter. While a context executes, its memory and arrays are those of the calling
+thread and the thread prints to its streams, which write straight into the buffers of the caller */
+struct IpwContext
+{
+    IpwOptions options;
+    struct Memory *memory;  // NULL until the first execution
+    Array *arrays;
+    FILE *out;
+    FILE *err;
+    IpwOutput *output;      // of the current execution; NULL to discard
+    char message[IPW_MESSAGE_SIZE];
+    size_t messageLength;
+};
+
+/* State of the calling thread while a context executes on it */
+typedef struct Saved
+{
+    struct Memory *memory;
+    Array *arrays;
+    FILE *out;
+    FILE *err;
+} Saved;
+
+// Local functions
+ssize_t writeOutput(void *cookie, const char *data, size_t size);
+ssize_t writeMessage(void *cookie, const char *data, size_t size);
+void enter(IpwContext *context, Saved *saved);
+void leave(IpwContext *context, const Saved *saved);
+IpwStatus run(IpwContext *context, const char *source, size_t size, int *line);
+
+ssize_t writeOutput(void *cookie, const char *data, size_t size)
+{
+    /* Local function
+    EFFECT: Stream function appending the _size_ characters at _data_ to the output buffer of the context
+    _cookie_, as far as they fit next to the terminating NUL, and counting all of them
+    OUTPUT: _size_, as nothing is ever rejected */
+
+    IpwOutput *output = ((IpwContext *) cookie)->output;
+    if (!output)
+    {
+        return size;
+    }
+
+    if (output->length + 1 < output->size)
+    {
+        size_t room = output->size - 1 - output->length;
+        memcpy(output->data + output->length, data, size < room ? size : room);
+    }
+    output->length += size;
+
+    return size;
+}
+
+
+ssize_t writeMessage(void *cookie, const char *data, size_t size)
+{
+    /* Local function
+    EFFECT: Stream function appending the _size_ characters at _data_ to the error message of the context
+    _cookie_, as far as they fit
+    OUTPUT: _size_, as nothing is ever rejected */
+
+    IpwContext *context = cookie;
+    size_t room = IPW_MESSAGE_SIZE - 1 - context->messageLength;
+
+    memcpy(context->message + context->messageLength, data, size < room ? size : room);
+    context->messageLength += size < room ? size : room;
+
+    return size;
+}
+
+
+void enter(IpwContext *context, Saved *saved)
+{
+    /* Local function
+    EFFECT: Makes the memory, arrays, and streams of _context_ those of the calling thread, saving the
+    previous ones in _saved_ */
+
+    saved->memory = memSwap(context->memory);
+    saved->arrays = swapArrays(context->arrays);
+    saved->out = outStream();
+    saved->err = errStream();
+    setStreams(context->out, context->err);
+}
+
+
+void leave(IpwContext *context, const Saved *saved)
+{
+    /* Local function
+    EFFECT: Takes the memory and arrays of _context_ back from the calling thread and restores the state
+    _saved_ by enter() */
+
+    fflush(context->out);
+    fflush(context->err);
+
+    context->arrays = swapArrays(saved->arrays);
+    context->memory = memSwap(saved->memory);
+    setStreams(saved->out, saved->err);
+}
+
+
+IpwStatus run(IpwContext *context, const char *source, size_t size, int *line)
+{
+    /* Local function
+    EFFECT: Decodes, analyses, and executes the program held in the _size_ characters at _source_ on the
+    emptied memory of the calling thread, like the interpreter executable does. _line_ is set to the line
+    at which execution stopped, if any
+    OUTPUT: The status of the execution */
+
+    if (resetAll())
+    {
+        return IPW_ERROR_MEMORY;
+    }
+
+    Program program;
+    programInit(&program);
+
+    const char *end = source + size;
+    for (int number = 1; source < end; number++)
+    {
+        const char *nl = memchr(source, '\n', end - source);
+        const char *lineEnd = nl ? nl : end;
+
+        if (programAddLine(&program, source, lineEnd - source, number))
+        {
+            programFree(&program);
+            return IPW_ERROR_MEMORY;
+        }
+        source = nl ? nl + 1 : end;
+    }
+
+    if (analyseBounds(&program) < 0 || (context->options.earlyFree && analyseLiveness(&program) < 0))
+    {
+        programFree(&program);
+        return IPW_ERROR_MEMORY;
+    }
+
+    // Without native code support the program is simply interpreted
+    if (context->options.jit)
+    {
+        program.jit = jitCompile(&program);
+    }
+
+    int error = executeProgram(&program);
+    *line = program.errorLine;
+    programFree(&program);
+
+    return error == 0 ? IPW_OK : error == 2 ? IPW_ERROR_MEMORY : IPW_ERROR_LINE;
+}
+
+
+IpwContext *ipwCreate(const IpwOptions *options)
+{
+    static const cookie_io_functions_t outFunctions = { NULL, writeOutput, NULL, NULL };
+    static const cookie_io_functions_t errFunctions = { NULL, writeMessage, NULL, NULL };
+
+    IpwContext *context = calloc(1, sizeof(IpwContext));
+    if (!context)
+    {
+        return NULL;
+    }
+
+    if (options)
+    {
+        context->options = *options;
+    }
+
+    context->out = fopencookie(context, "w", outFunctions);
+    context->err = fopencookie(context, "w", errFunctions);
+    if (!context->out || !context->err)
+    {
+        ipwDestroy(context);
+        return NULL;
+    }
+
+    return context;
+}
+
+
+void ipwDestroy(IpwContext *context)
+{
+    if (!context)
+    {
+        return;
+    }
+
+    if (context->out && context->err)
+    {
+        Saved saved;
+        context->output = NULL;
+        enter(context, &saved);
+        freeAll();
+        leave(context, &saved);
+    }
+
+    if (context->out)
+    {
+        fclose(context->out);
+    }
+    if (context->err)
+    {
+        fclose(context->err);
+    }
+    free(context);
+}
+
+
+IpwStatus ipwExecute(IpwContext *context, const char *source, size_t size, IpwOutput *output, IpwError *error)
+{
+    IpwError ignored;
+    if (!error)
+    {
+        error = &ignored;
+    }
+
+    memset(error, 0, sizeof(IpwError));
+    if (!context || (!source && size) || (output && output->size && !output->data))
+    {
+        error->status = IPW_ERROR_ARGUMENT;
+        return error->status;
+    }
+
+    context->output = output;
+    context->messageLength = 0;
+    if (output)
+    {
+        output->length = 0;
+    }
+
+    Saved saved;
+    enter(context, &saved);
+    error->status = run(context, source, size, &error->line);
+    leave(context, &saved);
+
+    if (output && output->size)
+    {
+        output->data[output->length < output->size ? output->length : output->size - 1] = '\0';
+    }
+
+    // The message without its final newline
+    while (context->messageLength && context->message[context->messageLength - 1] == '\n')
+    {
+        context->messageLength--;
+    }
+    memcpy(error->message, context->message, context->messageLength);
+    error->message[context->messageLength] = '\0';
+
+    return error->status;
+}
+
+
+const char *ipwStatusText(IpwStatus status)
+{
+    switch (status)
+    {
+        case IPW_OK: return "success";
+        case IPW_ERROR_LINE: return "a line failed";
+        case IPW_ERROR_MEMORY: return "not enough memory";
+        case IPW_ERROR_ARGUMENT: return "invalid argument";
+    }
+
+    return "unknown status";
+}
@@ -0,0 +1,64 @@
+#ifndef IPWASH_H
+#define IPWASH_H
+
+#include <stddef.h>
+
+/* libipwash: executes programs of the mini-language (see interpreter.h) held in memory, within the calling
+process. A context holds the memory and the arrays of one interpreter. Contexts are independent: one
+thread may use several in turn and different threads may use different contexts concurrently, but a
+context is only used by one thread at a time */
+
+typedef struct IpwContext IpwContext;
+
+/* Options of a context; all zero selects the defaults */
+typedef struct IpwOptions
+{
+    int jit;            // compile straight-line blocks to native code, like --jit
+    int earlyFree;      // free arrays right after their last use, like --early-free
+} IpwOptions;
+
+/* Outcome of executing a program */
+typedef enum IpwStatus
+{
+    IPW_OK,
+    IPW_ERROR_LINE,         // a line failed to parse or execute; execution stopped at it
+    IPW_ERROR_MEMORY,       // allocating memory to load or execute the program failed
+    IPW_ERROR_ARGUMENT      // invalid arguments, e.g. no context
+} IpwStatus;
+
+#define IPW_MESSAGE_SIZE 256
+
+/* Why executing a program failed */
+typedef struct IpwError
+{
+    IpwStatus status;
+    int line;                           // line at which execution stopped; 0 if none
+    char message[IPW_MESSAGE_SIZE];     // what the interpreter reported, truncated; empty if nothing
+} IpwError;
+
+/* Buffer provided by the caller for the output of a program */
+typedef struct IpwOutput
+{
+    char *data;         // receives the output, NUL-terminated unless _size_ is 0
+    size_t size;        // capacity of _data_
+    size_t length;      // set to the length of the whole output; it was truncated if this is >= _size_
+} IpwOutput;
+
+/* EFFECT: Creates a context with _options_, or the defaults if _options_ is NULL
+OUTPUT: The context; NULL if allocating memory failed */
+IpwContext *ipwCreate(const IpwOptions *options);
+
+/* EFFECT: Frees _context_ with all its arrays and memory */
+void ipwDestroy(IpwContext *context);
+
+/* EFFECT: Executes the program held in the _size_ characters at _source_ in _context_, starting from an
+empty memory, and stops at the first line that fails, exactly like the interpreter executable. What the
+program prints is stored in _output_, which may be NULL to discard it. Unless _error_ is NULL, the outcome
+is stored in it, with the line and message of the failure
+OUTPUT: The status of the execution, also stored in _error_ */
+IpwStatus ipwExecute(IpwContext *context, const char *source, size_t size, IpwOutput *output, IpwError *error);
+
+/* OUTPUT: A description of _status_ */
+const char *ipwStatusText(IpwStatus status);
+
+#endif
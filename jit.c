@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "functions.h"
+#include "jit.h"
+#include "program.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+
+#include <sys/mman.h>
+
+// Upper bound of the native code emitted for one instruction
+#define MAX_INSTRUCTION_BYTES 64
+
+/* Compiled block: instructions [start, start + length) of the program. The native code at _entry_ 
+receives in rdi an array with the address of the first cell of each array the block uses */
+typedef struct Block
+{
+    int start;
+    int length;
+    size_t entry;
+    int slotOffset;     // first slot of the block in _slots_ of the JitCode
+    int slotCount;
+} Block;
+
+struct JitCode
+{
+    unsigned char *buffer;
+    size_t size;
+    int *blockAt;       // block starting at every instruction; -1 if none
+    Block *blocks;
+    int blockCount;
+    int *slots;         // slots used by each block, in the order of their base pointers
+    int **bases;        // base pointers passed to a block
+};
+
+typedef void (*BlockFunction)(int **bases);
+
+// Local functions
+int jittable(const Instruction *instruction);
+void emit8(unsigned char **out, int byte);
+void emit32(unsigned char **out, int32_t value);
+void emitLoadBase(unsigned char **out, int reg, int index);
+void emitInstruction(unsigned char **out, const Instruction *instruction, int base1, int base2, int length);
+
+int jittable(const Instruction *instruction)
+{
+    /* Local function
+    EFFECT: Checks whether _instruction_ can be compiled to native code
+    OUTPUT: 1 if _instruction_ can be compiled; 0 otherwise */
+
+    // Freeing dead arrays is left to the interpreter
+    if (!(instruction->flags & INS_UNCHECKED) || (instruction->flags & (INS_FREE1 | INS_FREE2)))
+    {
+        return 0;
+    }
+
+    switch (instruction->op)
+    {
+        case OP_INC:
+        case OP_DEC:
+            // The byte offset of the cell must fit in a 32-bit displacement
+            return instruction->value <= INT32_MAX / 4;
+        case OP_ASS:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_AND:
+        case OP_XOR:
+            return 1;
+    }
+
+    return 0;
+}
+
+
+void emit8(unsigned char **out, int byte)
+{
+    *(*out)++ = (unsigned char) byte;
+}
+
+
+void emit32(unsigned char **out, int32_t value)
+{
+    memcpy(*out, &value, sizeof(value));
+    *out += sizeof(value);
+}
+
+
+void emitLoadBase(unsigned char **out, int reg, int index)
+{
+    /* Local function
+    EFFECT: Emits mov reg, [rdi + 8 * _index_] where _reg_ is 6 for rsi or 2 for rdx */
+
+    emit8(out, 0x48);
+    emit8(out, 0x8B);
+    emit8(out, 0x87 | (reg << 3));
+    emit32(out, 8 * index);
+}
+
+
+void emitInstruction(unsigned char **out, const Instruction *instruction, int base1, int base2, int length)
+{
+    /* Local function
+    EFFECT: Emits the native code of _instruction_. The first cell of its first array is at base 
+    pointer _base1_, that of its second array at _base2_. _length_ is the length of the arrays for 
+    And and Xor. The code only uses registers that the caller saves (rax, rcx, rdx, rsi, r8) */
+
+    emitLoadBase(out, 6, base1);
+    if (base2 >= 0)
+    {
+        emitLoadBase(out, 2, base2);
+    }
+
+    switch (instruction->op)
+    {
+        case OP_ASS:
+            // mov dword [rsi], value
+            emit8(out, 0xC7); emit8(out, 0x06); emit32(out, instruction->value);
+            break;
+        case OP_INC:
+            // add dword [rsi + 4 * index], 1
+            emit8(out, 0x83); emit8(out, 0x86); emit32(out, 4 * instruction->value); emit8(out, 1);
+            break;
+        case OP_DEC:
+            // sub dword [rsi + 4 * index], 1
+            emit8(out, 0x83); emit8(out, 0xAE); emit32(out, 4 * instruction->value); emit8(out, 1);
+            break;
+        case OP_ADD:
+            // mov eax, [rdx]; add [rsi], eax
+            emit8(out, 0x8B); emit8(out, 0x02);
+            emit8(out, 0x01); emit8(out, 0x06);
+            break;
+        case OP_SUB:
+            // mov eax, [rdx]; sub [rsi], eax
+            emit8(out, 0x8B); emit8(out, 0x02);
+            emit8(out, 0x29); emit8(out, 0x06);
+            break;
+        case OP_MUL:
+            // mov eax, [rdx]; mov ecx, [rsi]; imul ecx, eax; mov [rsi], ecx
+            emit8(out, 0x8B); emit8(out, 0x02);
+            emit8(out, 0x8B); emit8(out, 0x0E);
+            emit8(out, 0x0F); emit8(out, 0xAF); emit8(out, 0xC8);
+            emit8(out, 0x89); emit8(out, 0x0E);
+            break;
+        case OP_AND:
+        case OP_XOR:
+        {
+            // xor r8d, r8d
+            emit8(out, 0x45); emit8(out, 0x31); emit8(out, 0xC0);
+            unsigned char *loop = *out;
+
+            // mov eax, [rsi + 4 * r8]; mov ecx, [rdx + 4 * r8]
+            emit8(out, 0x42); emit8(out, 0x8B); emit8(out, 0x04); emit8(out, 0x86);
+            emit8(out, 0x42); emit8(out, 0x8B); emit8(out, 0x0C); emit8(out, 0x82);
+
+            if (instruction->op == OP_AND)
+            {
+                // imul eax, ecx
+                emit8(out, 0x0F); emit8(out, 0xAF); emit8(out, 0xC1);
+            }
+            else
+            {
+                // add eax, ecx
+                emit8(out, 0x01); emit8(out, 0xC8);
+            }
+
+            // eax % 2 with the sign of eax, as in C: mov ecx, eax; sar ecx, 31; and eax, 1; 
+            // xor eax, ecx; sub eax, ecx
+            emit8(out, 0x89); emit8(out, 0xC1);
+            emit8(out, 0xC1); emit8(out, 0xF9); emit8(out, 0x1F);
+            emit8(out, 0x83); emit8(out, 0xE0); emit8(out, 0x01);
+            emit8(out, 0x31); emit8(out, 0xC8);
+            emit8(out, 0x29); emit8(out, 0xC8);
+
+            // mov [rsi + 4 * r8], eax; inc r8; cmp r8, length; jl loop
+            emit8(out, 0x42); emit8(out, 0x89); emit8(out, 0x04); emit8(out, 0x86);
+            emit8(out, 0x49); emit8(out, 0xFF); emit8(out, 0xC0);
+            emit8(out, 0x49); emit8(out, 0x81); emit8(out, 0xF8); emit32(out, length);
+            emit8(out, 0x0F); emit8(out, 0x8C); emit32(out, (int32_t) (loop - (*out + 4)));
+            break;
+        }
+    }
+}
+
+
+JitCode *jitCompile(const Program *program)
+{
+    JitCode *code = calloc(1, sizeof(JitCode));
+    int *lengths = calloc(program->nameCount + 1, sizeof(int));
+    int *localIndex = malloc((program->nameCount + 1) * sizeof(int));
+    if (!code || !lengths || !localIndex)
+    {
+        goto fail;
+    }
+
+    code->blockAt = malloc((program->length + 1) * sizeof(int));
+    code->blocks = malloc((program->length / 2 + 1) * sizeof(Block));
+    code->slots = malloc((2 * program->length + 1) * sizeof(int));
+    if (!code->blockAt || !code->blocks || !code->slots)
+    {
+        goto fail;
+    }
+
+    for (int i = 0; i < program->nameCount; i++)
+    {
+        localIndex[i] = -1;
+    }
+
+    // Find the blocks and the slots they use
+    int slotCount = 0;
+    int maxSlots = 0;
+    size_t size = 0;
+    for (int i = 0; i < program->length; i++)
+    {
+        code->blockAt[i] = -1;
+        if (!jittable(&program->code[i]) || i + 1 == program->length || !jittable(&program->code[i + 1]))
+        {
+            continue;
+        }
+
+        Block *block = &code->blocks[code->blockCount];
+        block->start = i;
+        block->slotOffset = slotCount;
+        block->slotCount = 0;
+        while (i < program->length && jittable(&program->code[i]))
+        {
+            const Instruction *instruction = &program->code[i];
+            int slots[2] = { instruction->slot1, instruction->slot2 };
+            for (int k = 0; k < 2; k++)
+            {
+                if (slots[k] >= 0 && localIndex[slots[k]] < 0)
+                {
+                    localIndex[slots[k]] = block->slotCount++;
+                    code->slots[slotCount++] = slots[k];
+                }
+            }
+            code->blockAt[i] = -1;
+            i++;
+        }
+        i--;
+
+        block->length = i - block->start + 1;
+        code->blockAt[block->start] = code->blockCount++;
+        size += (size_t) block->length * MAX_INSTRUCTION_BYTES + 1;
+        if (block->slotCount > maxSlots)
+        {
+            maxSlots = block->slotCount;
+        }
+
+        for (int k = 0; k < block->slotCount; k++)
+        {
+            localIndex[code->slots[block->slotOffset + k]] = -1;
+        }
+    }
+
+    if (!code->blockCount)
+    {
+        goto fail;
+    }
+
+    code->bases = malloc(maxSlots * sizeof(int *));
+    code->size = size;
+    code->buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (!code->bases || code->buffer == MAP_FAILED)
+    {
+        code->buffer = NULL;
+        goto fail;
+    }
+
+    // Emit the blocks, tracking array lengths as allocation, resizing, and freeing are never part of a block
+    unsigned char *out = code->buffer;
+    for (int i = 0, b = 0; i < program->length; i++)
+    {
+        const Instruction *instruction = &program->code[i];
+        if (instruction->op == OP_MAL || instruction->op == OP_REA)
+        {
+            lengths[instruction->slot1] = instruction->value;
+        }
+        else if (instruction->op == OP_FRE)
+        {
+            lengths[instruction->slot1] = 0;
+        }
+
+        if (b == code->blockCount || code->blocks[b].start != i)
+        {
+            continue;
+        }
+
+        Block *block = &code->blocks[b++];
+        for (int k = 0; k < block->slotCount; k++)
+        {
+            localIndex[code->slots[block->slotOffset + k]] = k;
+        }
+
+        block->entry = out - code->buffer;
+        for (int j = i; j < i + block->length; j++)
+        {
+            instruction = &program->code[j];
+            int base2 = instruction->slot2 >= 0 ? localIndex[instruction->slot2] : -1;
+            emitInstruction(&out, instruction, localIndex[instruction->slot1], base2, lengths[instruction->slot1]);
+        }
+        emit8(&out, 0xC3);
+
+        for (int k = 0; k < block->slotCount; k++)
+        {
+            localIndex[code->slots[block->slotOffset + k]] = -1;
+        }
+        i += block->length - 1;
+    }
+
+    if (mprotect(code->buffer, code->size, PROT_READ | PROT_EXEC))
+    {
+        goto fail;
+    }
+
+    free(lengths);
+    free(localIndex);
+    return code;
+
+fail:
+    free(lengths);
+    free(localIndex);
+    jitFree(code);
+    return NULL;
+}
+
+
+int jitRun(JitCode *code, int pc, Array **handles)
+{
+    int b = code->blockAt[pc];
+    if (b < 0)
+    {
+        return 0;
+    }
+
+    const Block *block = &code->blocks[b];
+    for (int k = 0; k < block->slotCount; k++)
+    {
+        code->bases[k] = arrayCells(handles[code->slots[block->slotOffset + k]]);
+    }
+
+    // ISO C has no conversion from data to function pointers, so copy the representation
+    BlockFunction function;
+    void *entry = code->buffer + block->entry;
+    memcpy(&function, &entry, sizeof(function));
+    function(code->bases);
+
+    return block->length;
+}
+
+
+void jitFree(JitCode *code)
+{
+    if (!code)
+    {
+        return;
+    }
+
+    if (code->buffer)
+    {
+        munmap(code->buffer, code->size);
+    }
+
+    free(code->blockAt);
+    free(code->blocks);
+    free(code->slots);
+    free(code->bases);
+    free(code);
+}
+
+#else
+
+// Portable build: no native code, every program is interpreted
+
+JitCode *jitCompile(const Program *program)
+{
+    return NULL;
+}
+
+
+int jitRun(JitCode *code, int pc, Array **handles)
+{
+    return 0;
+}
+
+
+void jitFree(JitCode *code)
+{
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "functions.h"
+#include "program.h"
+
+/* Native code for the straight-line blocks of a program */
+typedef struct JitCode JitCode;
+
+/* EFFECT: Translates every block of consecutive INS_UNCHECKED Ass, Inc, Dec, Add, Sub, Mul, And, and Xor
+instructions of _program_ into native x86-64 code in an executable buffer. Must be called after 
+analyseBounds(), as only instructions proven safe are compiled. Blocks consisting of a single 
+instruction are left to the interpreter
+OUTPUT: The compiled code; NULL if the platform is not supported, _program_ has no block worth 
+compiling, or allocating (executable) memory failed. In all these cases the program can simply be 
+interpreted */
+JitCode *jitCompile(const Program *program);
+
+/* EFFECT: Runs the compiled block starting at instruction _pc_, if there is one. _handles_ holds the 
+handle of every live array by slot, as maintained by executeProgram()
+OUTPUT: The number of instructions executed; 0 if no compiled block starts at _pc_ */
+int jitRun(JitCode *code, int pc, Array **handles);
+
+/* EFFECT: Frees _code_ and its executable buffer. _code_ may be NULL */
+void jitFree(JitCode *code);
+
+#endif
@@ -1,83 +1,455 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "interpreter.h"
+#include "memory.h"
+#include "analysis.h"
+#include "jit.h"
+#include "binary.h"
+#include "cache.h"
+#include "parse.h"
+#include "pipeline.h"
+#include "pool.h"
+#include "profile.h"
+#include "batch.h"
+#include "server.h"
+#include "output.h"
 
-#define MAX_LENGTH 20
+// Compile straight-line blocks to native code (--jit)
+static int use_jit = 0;
 
-int formatLine(FILE *file, char *line);
+// Free arrays right after their last use (--early-free)
+static int early_free = 0;
+
+// Execute lines as they arrive instead of loading the whole program first ("-" or --fd)
+static int stream_mode = 0;
+
+// Directory of the compiled-program cache (--cache) and its size limit in bytes (--cache-size)
+static const char *cache_dir = NULL;
+static uint64_t cache_limit = CACHE_DEFAULT_SIZE;
+
+// Report where the time goes after executing (--profile)
+static int profile_mode = 0;
+
+// Read, decode, and execute on separate threads (--pipeline)
+static int pipeline_mode = 0;
+
+// Threads decoding large programs; only the main thread of a single run decodes in parallel
+static int parse_threads = 1;
+
+// Threads executing independent instructions and pointwise operations on large arrays of a single run
+// (--parallel)
+static Pool *exec_pool = NULL;
+
+// Size of the chunks read in streaming mode
+#define CHUNK_SIZE 65536
+
+int addLines(Program *program, const char *data, size_t size, int *line_number);
+int loadMapped(FILE *file, Program *program);
+int loadStream(FILE *file, Program *program);
+int streamFile(int fd);
+int analyseProgram(Program *program);
+int runProfiled(Program *program);
+int runLoaded(Program *program);
 int readFile(FILE *file);
+int runBuffer(const char *data, size_t size);
+int runBatchFile(FILE *file);
 int runProgram(FILE *file);
+int compileProgram(FILE *file, const char *output);
+int parseCount(const char *text, int minimum, int *value);
 
-int formatLine(FILE *file, char *line)
+int addLines(Program *program, const char *data, size_t size, int *line_number)
 {
-    /* EFFECT: Formats _line_ into a usable string by trimming the end and checking whether it is 
-    not longer than _MAX_LENGTH_ characters
-    OUTPUT: 0 upon successful execution; 1 if the string is longer than _MAX_LENGTH_ characters */
+    /* EFFECT: Splits the _size_ characters at _data_ into lines and decodes them into _program_ in
+    place. _line_number_ is the number of the first line and is advanced past the last one
+    OUTPUT: 0 upon successful execution; 1 if allocating memory failed */
+
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *nl = memchr(data, '\n', end - data);
+        const char *line_end = nl ? nl : end;
+
+        if (programAddLine(program, data, line_end - data, *line_number))
+        {
+            fprintf(errStream(), "Error: line %d: not enough memory to load the program\n", *line_number);
+            return 1;
+        }
+
+        (*line_number)++;
+        data = nl ? nl + 1 : end;
+    }
+
+    return 0;
+}
 
-    int flush = 0;
 
-    // Check whether more character exist on line
-    if (!strchr(line, '\n')) 
+int loadMapped(FILE *file, Program *program)
+{
+    /* EFFECT: Maps _file_ read-only and decodes all its lines into _program_ without copying them. 
+    Large programs are decoded in parallel (see parse.h). Precompiled programs (see binary.h) are 
+    loaded in place and keep the mapping. With --cache, 
+    programs are taken from the cache if it holds them, and analysed and added to it otherwise
+    OUTPUT: 0 upon successful execution; 1 if _file_ cannot be mapped (e.g. a pipe);
+    2 if allocating memory failed; 3 if _file_ is an invalid precompiled program */
+
+    struct stat info;
+    if (fstat(fileno(file), &info) || !S_ISREG(info.st_mode))
+    {
+        return 1;
+    }
+
+    // Empty files cannot be mapped, but are valid (empty) programs
+    if (info.st_size == 0)
     {
-        flush = 1;
+        return 0;
     }
 
-    if (flush) 
-    {		
-        // Remove all whitespace characters left in the line. If not a whitespace, terminate program
-        int c;
-        while ((c = fgetc(file)) != '\n' && c != EOF) 
+    size_t size = (size_t) info.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED)
+    {
+        return 1;
+    }
+    madvise((void *) data, size, MADV_SEQUENTIAL);
+
+    if (isBinaryProgram(data, size))
+    {
+        int status = programMap(program, data, size);
+        if (status)
         {
-            if (!isspace((unsigned char) c))
+            munmap((void *) data, size);
+            fprintf(errStream(), status == 2 ? "Error: not enough memory to load the program\n"
+                                             : "Error: invalid precompiled program\n");
+            return status == 2 ? 2 : 3;
+        }
+
+        return 0;
+    }
+
+    CacheKey key = { { 0 }, 0 };
+    if (cache_dir)
+    {
+        key = cacheKey(data, size, early_free);
+        int status = cacheLoad(cache_dir, key, program);
+        if (status != 1)
+        {
+            munmap((void *) data, size);
+            if (status)
             {
-                return 1;
-            }	
+                fprintf(errStream(), "Error: not enough memory to load the program\n");
+            }
+            return status;
+        }
+    }
+
+    int error;
+    if (parse_threads > 1 && size >= PARALLEL_PARSE_SIZE)
+    {
+        error = parseParallel(program, data, size, parse_threads);
+        if (error)
+        {
+            fprintf(errStream(), "Error: not enough memory to load the program\n");
         }
     }
+    else
+    {
+        int line_number = 1;
+        error = addLines(program, data, size, &line_number);
+    }
+    munmap((void *) data, size);
+    if (error)
+    {
+        return 2;
+    }
 
-    // Remove newline for the interpreter
-    char *nl = strchr(line, '\n');
-    if (nl) 
+    // Failing to add the program to the cache only costs the next run the parsing
+    if (cache_dir)
     {
-        *nl = '\0';
+        if (analyseProgram(program))
+        {
+            return 2;
+        }
+        cacheStore(cache_dir, key, program, cache_limit);
     }
 
     return 0;
 }
 
 
-int readFile(FILE *file)
+int loadStream(FILE *file, Program *program)
 {
-    /* EFFECT: Reads, interprets, and executes lines from _file_
-    OUTPUT: 0 upon successful execution; 1 if the string is longer than _MAX_LENGTH_ characters
+    /* EFFECT: Reads _file_ line by line and decodes all lines into _program_. Used for inputs that
+    cannot be mapped; lines may be of any length
+    OUTPUT: 0 upon successful execution; 1 if allocating memory failed */
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int line_number = 1;
+    int error = 0;
+
+    while (!error && (length = getline(&line, &capacity, file)) >= 0)
+    {
+        error = addLines(program, line, length, &line_number);
+    }
+    free(line);
+
+    return error;
+}
+
+
+int streamFile(int fd)
+{
+    /* EFFECT: Reads the program from _fd_ in large chunks and interprets every line as soon as it is
+    complete, so execution overlaps with whatever produces the program. Lines split across chunks
+    are kept until their end arrives; lines longer than a chunk grow the buffer
+    OUTPUT: 0 upon successful execution; 1 if reading or allocating memory failed;
     2 if interpreting and executing a line failed */
 
-	int line_number = 1;
-	char line[MAX_LENGTH + 1];
-	
-	while (fgets(line, sizeof(line), file)) 
-	{
-        if (formatLine(file, line))
+    size_t capacity = CHUNK_SIZE;
+    size_t used = 0;
+    char *buffer = malloc(capacity + 1);
+    if (!buffer)
+    {
+        fprintf(errStream(), "Error: not enough memory to read the program\n");
+        return 1;
+    }
+
+    for (;;)
+    {
+        if (used == capacity)
         {
-                fprintf(stderr, "Error: line %d: invalid line. Too many characters\n", line_number);
+            char *larger = realloc(buffer, 2 * capacity + 1);
+            if (!larger)
+            {
+                free(buffer);
+                fprintf(errStream(), "Error: not enough memory to read the program\n");
                 return 1;
+            }
+            buffer = larger;
+            capacity *= 2;
         }
-		
-        if (interpretLine(line))
+
+        ssize_t n = read(fd, buffer + used, capacity - used);
+        if (n < 0 && errno == EINTR)
         {
-            // fprintf(stderr, "Error: line %d: a fatal error occurred\n", line_number);
-            return 2;
+            continue;
+        }
+        if (n < 0)
+        {
+            free(buffer);
+            fprintf(errStream(), "Error: reading the program failed\n");
+            return 1;
+        }
+        if (n == 0)
+        {
+            break;
         }
 
-		line_number++;
-	}
+        // The part before _used_ holds no newline, so only the new data needs to be searched
+        char *start = buffer;
+        char *end = buffer + used + n;
+        char *nl = memchr(buffer + used, '\n', n);
+        while (nl)
+        {
+            *nl = '\0';
+            if (interpretLine(start))
+            {
+                free(buffer);
+                return 2;
+            }
+
+            start = nl + 1;
+            nl = memchr(start, '\n', end - start);
+        }
+
+        // Keep the incomplete last line for the next chunk
+        used = end - start;
+        memmove(buffer, start, used);
+    }
+
+    // Last line without trailing newline
+    int error = 0;
+    if (used)
+    {
+        buffer[used] = '\0';
+        error = interpretLine(buffer) ? 2 : 0;
+    }
+    free(buffer);
+
+    return error;
+}
+
+
+int analyseProgram(Program *program)
+{
+    /* EFFECT: Runs the analysis passes over _program_ unless they already ran, e.g. when it was 
+    compiled
+    OUTPUT: 0 upon successful execution; 1 if allocating memory failed */
+
+    if (program->analysed)
+    {
+        return 0;
+    }
+
+    // Prove which accesses are safe, so they skip the runtime checks
+    if (analyseBounds(program) < 0 || (early_free && analyseLiveness(program) < 0))
+    {
+        fprintf(errStream(), "Error: not enough memory to analyse the program\n");
+        return 1;
+    }
+    program->analysed = 1;
 
     return 0;
 }
 
 
+int runProfiled(Program *program)
+{
+    /* EFFECT: Executes the analysed _program_ while profiling it and reports the profile to the error 
+    stream, also if execution stops early
+    OUTPUT: 0 upon successful execution; 1 if executing failed; 2 if allocating memory failed */
+
+    Profile profile;
+    if (profileInit(&profile, program))
+    {
+        fprintf(errStream(), "Error: not enough memory to profile the program\n");
+        return 2;
+    }
+
+    memSetProfile(&profile.memory);
+    int error = executeProgramProfiled(program, &profile);
+    memSetProfile(NULL);
+
+    profileReport(&profile, program, errStream());
+    profileFree(&profile);
+
+    return error;
+}
+
+
+int runLoaded(Program *program)
+{
+    /* EFFECT: Analyses and executes the decoded _program_, then frees it
+    OUTPUT: 0 upon successful execution; 2 if analysing, interpreting, or executing a line failed */
+
+    if (analyseProgram(program))
+    {
+        programFree(program);
+        return 2;
+    }
+
+    if (profile_mode)
+    {
+        int error = runProfiled(program);
+        programFree(program);
+        return error ? 2 : 0;
+    }
+
+    if (exec_pool)
+    {
+        int error = executeProgramParallel(program, exec_pool);
+        programFree(program);
+        return error ? 2 : 0;
+    }
+
+    // Without native code support the program is simply interpreted
+    if (use_jit)
+    {
+        program->jit = jitCompile(program);
+    }
+
+    if (executeProgram(program))
+    {
+        programFree(program);
+        return 2;
+    }
+    programFree(program);
+
+    return 0;
+}
+
+
+int readFile(FILE *file)
+{
+    /* EFFECT: Decodes all lines from _file_, then analyses and executes them
+    OUTPUT: 0 upon successful execution; 1 if loading the lines failed;
+    2 if interpreting and executing a line failed */
+
+	Program program;
+
+    if (pipeline_mode)
+    {
+        return runPipeline(fileno(file));
+    }
+
+    if (stream_mode)
+    {
+        return streamFile(fileno(file));
+    }
+
+	programInit(&program);
+    int error = loadMapped(file, &program);
+    if (error == 1)
+    {
+        programFree(&program);
+        error = loadStream(file, &program);
+    }
+
+    if (error)
+    {
+        programFree(&program);
+        return 1;
+    }
+
+    return runLoaded(&program);
+}
+
+
+int runBuffer(const char *data, size_t size)
+{
+    /* EFFECT: Runs the program held in the _size_ characters at _data_ in the already initialized 
+    context of the calling thread. Used for programs received by the server
+    OUTPUT: 0 upon successful execution; 1 if decoding the lines failed;
+    2 if interpreting and executing a line failed */
+
+    Program program;
+    int line_number = 1;
+
+    programInit(&program);
+    if (addLines(&program, data, size, &line_number))
+    {
+        programFree(&program);
+        return 1;
+    }
+
+    return runLoaded(&program);
+}
+
+
+int runBatchFile(FILE *file)
+{
+    /* EFFECT: Runs the program in _file_ in the already initialized context of the calling thread and
+    closes _file_. Used for every program of a batch
+    OUTPUT: 0 upon successful execution; 1 if reading, interpreting, or executing the lines of _file_
+    failed; 2 if closing _file_ failed */
+
+    int error = readFile(file) ? 1 : 0;
+    if (fclose(file) && !error)
+    {
+        error = 2;
+    }
+
+    return error;
+}
+
+
 int runProgram(FILE *file)
 {
     /* EFFECT: Initializes program; executes program line-by-line as described in _file_, with each
@@ -120,18 +492,313 @@ int runProgram(FILE *file)
 }
 
 
+int compileProgram(FILE *file, const char *output)
+{
+    /* EFFECT: Decodes and analyses the program in _file_ and writes it to the file _output_ as
+    precompiled program (see binary.h), which loads without parsing; closes _file_. The program is 
+    not executed. Arrays are freed early when it runs if --early-free is given now
+    OUTPUT: 0 upon successful execution; 1 if opening _file_ failed; 2 if loading or analysing the 
+    program failed; 3 if writing _output_ failed */
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: opening file failed\n");
+        return 1;
+    }
+
+    Program program;
+    programInit(&program);
+    int error = loadMapped(file, &program);
+    if (error == 1)
+    {
+        programFree(&program);
+        error = loadStream(file, &program);
+    }
+    fclose(file);
+
+    if (error || analyseProgram(&program))
+    {
+        programFree(&program);
+        return 2;
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (!out || programWrite(&program, out) | fclose(out))
+    {
+        fprintf(stderr, "Error: writing %s failed\n", output);
+        programFree(&program);
+        return 3;
+    }
+    programFree(&program);
+
+    return 0;
+}
+
+
+int parseCount(const char *text, int minimum, int *value)
+{
+    /* EFFECT: Reads the decimal number _text_ of an option into _value_, which is left unchanged if 
+    _text_ is not a whole number of at least _minimum_ that fits in an int
+    OUTPUT: 0 upon successful execution; 1 if _text_ is not such a number */
+
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end || errno || number < minimum || number > INT_MAX)
+    {
+        return 1;
+    }
+    *value = (int) number;
+
+    return 0;
+}
+
+
 int main(int argc, char *argv[]) 
 {
-    /* EFFECT: Reads, interprets, and executes lines in the format as described in interpreter.h
+    /* EFFECT: Reads, interprets, and executes lines in the format as described in interpreter.h from
+    the file given as argument, or as they arrive from standard input ("-") or a file descriptor
+    (--fd N)
     OUTPUT: 0 upon successful execution; 1 if an error occurred while executing */
 
-    if (argc != 2)
+    const char *filename = NULL;
+    const char *batch = NULL;
+    const char *out_dir = NULL;
+    const char *socket_path = NULL;
+    const char *compile_output = NULL;
+    const char *trace_path = NULL;
+    size_t max_program = SERVER_DEFAULT_MAX_PROGRAM;
+    int jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int exec_threads = 1;
+    int fd = -1;
+    int files = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--jit"))
+        {
+            use_jit = 1;
+        }
+        else if (!strcmp(argv[i], "--early-free"))
+        {
+            early_free = 1;
+        }
+        else if (!strcmp(argv[i], "--alloc-policy") && i + 1 < argc)
+        {
+            // Choose how memAlloc() picks free segments
+            MemPolicy policy;
+            if (memPolicyByName(argv[++i], &policy))
+            {
+                fprintf(stderr, "Error: unknown allocation policy %s (best, first, next, worst)\n", argv[i]);
+                return 1;
+            }
+            memSetPolicy(policy);
+        }
+        else if (!strcmp(argv[i], "--trace-alloc") && i + 1 < argc)
+        {
+            // Log the allocator calls for replaying them offline (see bench/replay.c)
+            trace_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--profile"))
+        {
+            profile_mode = 1;
+        }
+        else if (!strcmp(argv[i], "--cells") && i + 1 < argc)
+        {
+            // Size of the memory
+            int cells;
+            if (parseCount(argv[++i], 1, &cells) || memSetCells(cells))
+            {
+                fprintf(stderr, "Error: the number of cells must be positive\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--sparse"))
+        {
+            // Only give memory to the pages of cells that are written
+            memSetSparse(1);
+        }
+        else if (!strcmp(argv[i], "--parallel") && i + 1 < argc)
+        {
+            // Execute independent instructions on a pool of threads
+            if (parseCount(argv[++i], 1, &exec_threads))
+            {
+                fprintf(stderr, "Error: the number of threads must be positive\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--pipeline"))
+        {
+            pipeline_mode = 1;
+        }
+        else if (!strcmp(argv[i], "--fd") && i + 1 < argc)
+        {
+            // Stream the program from an inherited file descriptor
+            if (parseCount(argv[++i], 0, &fd))
+            {
+                fprintf(stderr, "Error: the file descriptor must be a number\n");
+                return 1;
+            }
+            files++;
+        }
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+        {
+            // Run all programs of a directory or list file
+            batch = argv[++i];
+            files++;
+        }
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+        {
+            // Serve programs over a Unix domain socket
+            socket_path = argv[++i];
+            files++;
+        }
+        else if (!strcmp(argv[i], "--max-program") && i + 1 < argc)
+        {
+            // Size limit of the programs the server accepts, in bytes
+            const char *size = argv[++i];
+            char *end;
+            errno = 0;
+            unsigned long long limit = strtoull(size, &end, 10);
+            if (end == size || *end || *size == '-' || errno || !limit || limit >= SIZE_MAX)
+            {
+                fprintf(stderr, "Error: the program size limit must be a positive number of bytes\n");
+                return 1;
+            }
+            max_program = (size_t) limit;
+        }
+        else if (!strcmp(argv[i], "--compile") && i + 1 < argc)
+        {
+            // Write the program precompiled instead of running it
+            compile_output = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+        {
+            // Reuse programs compiled by earlier runs
+            cache_dir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cache-size") && i + 1 < argc)
+        {
+            // Size limit of the cache directory in bytes; a limit of 0 would evict every entry right away
+            const char *size = argv[++i];
+            char *end;
+            errno = 0;
+            cache_limit = strtoull(size, &end, 10);
+            if (end == size || *end || *size == '-' || errno || !cache_limit)
+            {
+                fprintf(stderr, "Error: the cache size must be a positive number of bytes\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc)
+        {
+            // Programs run or parsed at once
+            if (parseCount(argv[++i], 1, &jobs))
+            {
+                fprintf(stderr, "Error: the number of jobs must be positive\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--out-dir") && i + 1 < argc)
+        {
+            out_dir = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-"))
+        {
+            // Stream the program from standard input
+            fd = STDIN_FILENO;
+            files++;
+        }
+        else
+        {
+            filename = argv[i];
+            files++;
+        }
+    }
+
+    if (files != 1)
     {
         fprintf(stderr, "Please provide (only) the file to read\n");
     }
 
-	FILE* file = fopen(argv[1], "r");
-	if (runProgram(file))
+    // Streamed and pipelined lines run as soon as they are decoded, so nothing can see the whole program
+    // first; options that need it are rejected rather than ignored
+    if ((fd >= 0 || pipeline_mode) && !batch && !socket_path && !compile_output
+        && (use_jit || early_free || profile_mode || cache_dir || exec_threads > 1))
+    {
+        fprintf(stderr, "Error: --jit, --early-free, --profile, --parallel, and --cache need the whole program "
+                        "and can not be used with -, --fd, or --pipeline\n");
+        return 1;
+    }
+
+    // Batches and servers run programs on worker threads, which are not traced
+    if (trace_path && (batch || socket_path))
+    {
+        fprintf(stderr, "Error: --trace-alloc can not be used with --batch or --serve\n");
+        return 1;
+    }
+
+    // Batches and servers already keep every processor busy with whole programs
+    if (!socket_path && !batch)
+    {
+        parse_threads = jobs;
+        if (exec_threads > 1)
+        {
+            exec_pool = poolCreate(exec_threads);
+            setArrayPool(exec_pool);
+        }
+    }
+
+    // The server only returns if it could not start
+    if (socket_path)
+    {
+        return runServer(socket_path, jobs, max_program, runBuffer);
+    }
+
+    // A batch fails if it could not be read or any of its programs failed
+    if (batch)
+    {
+        return runBatch(batch, jobs, out_dir, runBatchFile) != 0;
+    }
+
+    if (compile_output)
+    {
+        return compileProgram(filename ? fopen(filename, "r") : fdopen(fd, "r"), compile_output) ? 1 : 0;
+    }
+
+	FILE* file = NULL;
+    if (fd >= 0)
+    {
+        stream_mode = 1;
+        file = fdopen(fd, "r");
+    }
+    else if (filename)
+    {
+        file = fopen(filename, "r");
+    }
+
+    FILE *trace = NULL;
+    if (trace_path)
+    {
+        trace = fopen(trace_path, "wb");
+        if (!trace || memTraceStart(trace))
+        {
+            fprintf(stderr, "Error: opening trace file %s failed\n", trace_path);
+            if (trace)
+            {
+                fclose(trace);
+            }
+            trace = NULL;
+        }
+    }
+
+    int error = runProgram(file);
+    if (trace && (memTraceStop() | fclose(trace)))
+    {
+        fprintf(stderr, "Error: writing trace file %s failed\n", trace_path);
+    }
+    poolDestroy(exec_pool);
+
+	if (error)
     {
         // This should return 1, as the program did not run successfully, not 0
         exit(0);
@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "memory.h"
+#include "output.h"
 
 
 /* Node for the free-list */
@@ -12,17 +17,96 @@ typedef struct FreeSeg {
 } FreeSeg;
 
 typedef struct Memory Memory;
-static Memory *m = NULL;
+typedef struct Cache Cache;
+
+// Each thread has its own memory, so independent programs can run concurrently
+static _Thread_local Memory *m = NULL;
+
+// Time spent in the checked accessors, while profiling
+static _Thread_local MemProfile *profile = NULL;
+
+// Events of the allocator buffered for the trace file, while tracing
+#define TRACE_BUFFER 4096
+typedef struct Trace {
+	FILE *file;
+	MemTraceEvent events[TRACE_BUFFER];
+	int count;
+	unsigned long long last;    // time of the previous event
+	int failed;                 // writing the file failed
+} Trace;
+static _Thread_local Trace *trace = NULL;
+
+/* Sparse memories keep their cells in pages of PAGE_CELLS cells, found
+ * through a directory of tables of TABLE_PAGES pages each. Tables and
+ * pages are only allocated when a cell in them is first written */
+#define PAGE_BITS 10
+#define TABLE_BITS 10
+#define PAGE_CELLS (1 << PAGE_BITS)
+#define TABLE_PAGES (1 << TABLE_BITS)
 
 /* Memory representation */
 struct Memory {
-	int cells[MEM_CELLS];  // simulated memory cells
+	int size;              // number of cells
 	FreeSeg *free_list;    // free segments linked list, sorted by start
+	int rover;             // where the next-fit search starts
+
+	// Only used by sparse memories, which have no cells, see memSetSparse()
+	int sparse;
+	int ***directory;      // tables by cell >> (PAGE_BITS + TABLE_BITS), NULL if none
+	int tables;            // entries of directory
+	int pages;             // pages allocated
+
+	// Only used once the memory is shared among threads, see memShare()
+	int shared;
+	pthread_mutex_t lock;  // protects free_list, rover, and caches
+	Cache *caches;         // caches of the threads that freed blocks in it
+	atomic_uchar *owned;   // 1 for every allocated cell
+	atomic_int users;      // threads attached
+
+	int cells[];           // simulated memory cells
+};
+
+// Freed blocks of up to CACHE_SIZES cells are kept by the freeing thread for
+// its next allocations of that size, so they bypass the lock of the pool,
+// as long as they take at most 1/CACHE_SHARE of the cells. Caches are linked
+// into their memory under its lock, so an allocation that finds no segment
+// can take back the blocks of every thread. Only the owner of a cache fills
+// its slots, and whoever takes a block empties its slot by exchanging it
+#define CACHE_SIZES 8
+#define CACHE_DEPTH 4
+#define CACHE_SHARE 16
+#define CACHE_EMPTY -1
+struct Cache {
+	atomic_int starts[CACHE_SIZES + 1][CACHE_DEPTH];  // CACHE_EMPTY if none
+	atomic_int cells;      // cells of the blocks held
+	Memory *memory;        // memory the cache is linked into, NULL if none
+	Cache *next;           // next cache of the same memory
 };
+static _Thread_local Cache cache;
+
+static void flushCache(void);
+
+/* Allocation policy: chooses the free segment for n cells and its
+ * predecessor in the free list, or returns NULL if none fits */
+typedef FreeSeg *(*FitFunction)(int n, FreeSeg **outPrev);
+
+static FreeSeg *bestFit(int n, FreeSeg **outPrev);
+static FreeSeg *firstFit(int n, FreeSeg **outPrev);
+static FreeSeg *nextFit(int n, FreeSeg **outPrev);
+static FreeSeg *worstFit(int n, FreeSeg **outPrev);
+
+// Indexed by MemPolicy; shared by all threads, chosen before they start
+static const FitFunction fits[] = { bestFit, firstFit, nextFit, worstFit };
+static const char *policyNames[] = { "best", "first", "next", "worst" };
+static MemPolicy policy = MEM_BEST_FIT;
+
+// Size and kind of memories initialised from now on; shared by all threads, like the policy
+static int cellCount = MEM_CELLS;
+static int sparseMode = 0;
 
 /* Prints error messages */
 static void error(const char *msg) {
-    fprintf(stderr, "%s\n", msg);
+    fprintf(errStream(), "%s\n", msg);
 }
 
 /* Allocate a new free segment node. Returns NULL on failure */
@@ -100,9 +184,103 @@ static void combine(FreeSeg *head) {
 	}
 }
 
+/* Cell i of a sparse memory, or NULL if its page was never written */
+static int *sparseCell(int i) {
+	int **table = m->directory[i >> (PAGE_BITS + TABLE_BITS)];
+	if (table == NULL) {
+		return NULL;
+	}
+
+	int *page = table[(i >> PAGE_BITS) & (TABLE_PAGES - 1)];
+	return page ? &page[i & (PAGE_CELLS - 1)] : NULL;
+}
+
+/* Cell i of a sparse memory, allocating its table and page as needed.
+ * Returns NULL if that fails */
+static int *sparseCellForWrite(int i) {
+	int ***table = &m->directory[i >> (PAGE_BITS + TABLE_BITS)];
+	if (*table == NULL) {
+		*table = (int **)calloc(TABLE_PAGES, sizeof(int *));
+		if (*table == NULL) {
+			return NULL;
+		}
+	}
+
+	int **page = &(*table)[(i >> PAGE_BITS) & (TABLE_PAGES - 1)];
+	if (*page == NULL) {
+		*page = (int *)calloc(PAGE_CELLS, sizeof(int));
+		if (*page == NULL) {
+			return NULL;
+		}
+		m->pages++;
+	}
+	return &(*page)[i & (PAGE_CELLS - 1)];
+}
+
+/* Set the cells [start, start + len) of a sparse memory to 0: pages
+ * inside the range are released, the parts of others are cleared */
+static void sparseClear(int start, int len) {
+	int end = start + len;
+
+	while (start < end) {
+		int pageEnd = (start | (PAGE_CELLS - 1)) + 1;
+		int stop = pageEnd < end ? pageEnd : end;
+		int **table = m->directory[start >> (PAGE_BITS + TABLE_BITS)];
+		int **page = table ? &table[(start >> PAGE_BITS) & (TABLE_PAGES - 1)] : NULL;
+
+		if (page != NULL && *page != NULL) {
+			if (stop - start == PAGE_CELLS) {
+				free(*page);
+				*page = NULL;
+				m->pages--;
+			}
+			else {
+				memset(&(*page)[start & (PAGE_CELLS - 1)], 0, (stop - start) * sizeof(int));
+			}
+		}
+		start = stop;
+	}
+}
+
+/* Release all tables and pages of a sparse memory */
+static void sparseRelease(void) {
+	for (int t = 0; t < m->tables; t++) {
+		if (m->directory[t] == NULL) {
+			continue;
+		}
+		for (int p = 0; p < TABLE_PAGES; p++) {
+			free(m->directory[t][p]);
+		}
+		free(m->directory[t]);
+		m->directory[t] = NULL;
+	}
+	m->pages = 0;
+}
+
+/* Value of cell i */
+static int cellValue(int i) {
+	if (m->sparse) {
+		int *cell = sparseCell(i);
+		return cell ? *cell : 0;
+	}
+	return m->shared ? __atomic_load_n(&m->cells[i], __ATOMIC_RELAXED) : m->cells[i];
+}
+
+/* Cell i for writing, or NULL if a sparse memory has no room for its page */
+static int *cellForWrite(int i) {
+	if (m->sparse) {
+		int *cell = sparseCellForWrite(i);
+		if (cell == NULL) {
+			error("Not enough memory.");
+		}
+		return cell;
+	}
+	return &m->cells[i];
+}
+
 /* Validate index i within memory */
 static int addrOK(int addr) {
-	return (addr >= 0 && addr < MEM_CELLS);
+	return (addr >= 0 && addr < m->size);
 }
 
 /* Validate index addr within allocated block */
@@ -115,6 +293,10 @@ static int isAllocated(int addr) {
 		return MEM_ERROR;
 	}
 
+	if (m->shared) {
+		return atomic_load_explicit(&m->owned[addr], memory_order_acquire) ? MEM_OK : MEM_ERROR;
+	}
+
 	FreeSeg *cur = m->free_list;
 	while (cur != NULL) {
 		if (addr >= cur->start && addr < cur->start + cur->len) {
@@ -126,6 +308,16 @@ static int isAllocated(int addr) {
 }
 
 
+/* Whether all cells [start, start + len) of memory that is not shared are
+ * allocated, which is the case if no free segment overlaps them */
+static int rangeAllocated(int start, int len) {
+	for (FreeSeg *cur = m->free_list; cur != NULL && cur->start < start + len; cur = cur->next) {
+		if (segEnd(cur) > start) {
+			return 0;
+		}
+	}
+	return 1;
+}
 
 /* Initialize all cells to 0 and allocator to one big free block */
 int memInit(void) {
@@ -133,18 +325,39 @@ int memInit(void) {
 		return MEM_OK;
 	}
 
-	m = malloc(sizeof(Memory));
+	// A sparse memory has no cells of its own, only a directory of tables
+	m = malloc(sizeof(Memory) + (sparseMode ? 0 : (size_t)cellCount * sizeof(int)));
 	if (m == NULL) {
 		error("Not enough memory.");
 		return MEM_ERROR;
 	}
 
-	for (int i = 0; i< MEM_CELLS; i++) {
-		m->cells[i] = 0;
+	m->size = cellCount;
+	m->sparse = sparseMode;
+	m->directory = NULL;
+	m->tables = 0;
+	m->pages = 0;
+	if (m->sparse) {
+		m->tables = ((m->size - 1) >> (PAGE_BITS + TABLE_BITS)) + 1;
+		m->directory = (int ***)calloc(m->tables, sizeof(int **));
+		if (m->directory == NULL) {
+			free(m);
+			m = NULL;
+			error("Not enough memory.");
+			return MEM_ERROR;
+		}
 	}
+	else {
+		for (int i = 0; i< m->size; i++) {
+			m->cells[i] = 0;
+		}
+	}
+	m->rover = 0;
+	m->shared = 0;
+	m->owned = NULL;
 
 	// One free segment covering the whole memory
-	m->free_list = newSeg(0, MEM_CELLS);
+	m->free_list = newSeg(0, m->size);
 	if (m->free_list == NULL) {
 		error("Not enough memory.");
 		return MEM_ERROR;
@@ -158,6 +371,17 @@ void memFree(void) {
 		return;
 	}
 
+	// Shared memory is released by the last thread attached
+	if (m->shared) {
+		flushCache();
+		if (atomic_fetch_sub(&m->users, 1) > 1) {
+			m = NULL;
+			return;
+		}
+		pthread_mutex_destroy(&m->lock);
+		free(m->owned);
+	}
+
 	// Walk through the list and free each node
 	FreeSeg *cur = m->free_list;
 	while (cur != NULL) {
@@ -165,23 +389,70 @@ void memFree(void) {
 		free(cur);
 		cur = next;
 	}
+	if (m->sparse) {
+		sparseRelease();
+		free(m->directory);
+	}
 	free(m);
 	m = NULL;
 }
 
-/* Allocate n cells using a best-fit policy (1 on success, 0 on failure) */
-int memAlloc(int n, int *outStart) {
-	if (m == NULL || outStart == NULL) {
-		error("Wrong Memory Access.");
-		return MEM_ERROR;
+/* Release all blocks at once by resetting the free list to one segment.
+ * Cells are not cleared, as memAlloc() zeroes every block it hands out,
+ * but the pages of a sparse memory are released and the ownership marks
+ * of a shared memory cleared, the one part that takes time per cell */
+int memReset(void) {
+	if (m == NULL) {
+		return memInit();
 	}
-	if (n <= 0 || n > MEM_CELLS) {
-		error("Wrong Memory Access.");
-		return MEM_ERROR;
+
+	// Keep the first node as the segment covering the whole memory
+	FreeSeg *head = m->free_list;
+	if (head == NULL) {
+		head = newSeg(0, m->size);
+		if (head == NULL) {
+			error("Not enough memory.");
+			return MEM_ERROR;
+		}
 	}
-	// Find best free segment (smallest with len >= n)
+
+	FreeSeg *cur = head->next;
+	while (cur != NULL) {
+		FreeSeg *next = cur->next;
+		free(cur);
+		cur = next;
+	}
+
+	head->start = 0;
+	head->len = m->size;
+	head->next = NULL;
+	m->free_list = head;
+	m->rover = 0;
+
+	if (m->sparse) {
+		sparseRelease();
+	}
+
+	// The blocks cached by threads are free again
+	if (m->shared) {
+		for (Cache *c = m->caches; c != NULL; c = c->next) {
+			for (int len = 1; len <= CACHE_SIZES; len++) {
+				for (int i = 0; i < CACHE_DEPTH; i++) {
+					atomic_store(&c->starts[len][i], CACHE_EMPTY);
+				}
+			}
+			atomic_store(&c->cells, 0);
+		}
+		for (int i = 0; i < m->size; i++) {
+			atomic_store(&m->owned[i], 0);
+		}
+	}
+	return MEM_OK;
+}
+
+/* Smallest segment with len >= n */
+static FreeSeg *bestFit(int n, FreeSeg **outPrev) {
 	FreeSeg *prev = NULL;
-	FreeSeg *bestPrev = NULL;
 	FreeSeg *best = NULL;
 	FreeSeg *cur = m->free_list;
 
@@ -191,7 +462,7 @@ int memAlloc(int n, int *outStart) {
 			// Update best choice
 			if (best == NULL || cur->len < best->len) {
 				best = cur;
-				bestPrev = prev;
+				*outPrev = prev;
 
 				// Perfect fit, stop searching
 				if (cur->len == n) {
@@ -202,11 +473,78 @@ int memAlloc(int n, int *outStart) {
 		prev = cur;
 		cur = cur->next;
 	}
+	return best;
+}
+
+/* Lowest segment with len >= n */
+static FreeSeg *firstFit(int n, FreeSeg **outPrev) {
+	FreeSeg *prev = NULL;
+
+	for (FreeSeg *cur = m->free_list; cur != NULL; cur = cur->next) {
+		if (cur->len >= n) {
+			*outPrev = prev;
+			return cur;
+		}
+		prev = cur;
+	}
+	return NULL;
+}
+
+/* First segment with len >= n at or after the end of the previous
+ * allocation, wrapping around to the start of memory */
+static FreeSeg *nextFit(int n, FreeSeg **outPrev) {
+	FreeSeg *prev = NULL;
+	FreeSeg *cur = m->free_list;
+
+	// Skip the segments before the rover
+	while (cur != NULL && segEnd(cur) <= m->rover) {
+		prev = cur;
+		cur = cur->next;
+	}
+
+	for (; cur != NULL; cur = cur->next) {
+		if (cur->len >= n) {
+			*outPrev = prev;
+			return cur;
+		}
+		prev = cur;
+	}
+
+	// Wrap around up to where the search started
+	prev = NULL;
+	for (cur = m->free_list; cur != NULL && segEnd(cur) <= m->rover; cur = cur->next) {
+		if (cur->len >= n) {
+			*outPrev = prev;
+			return cur;
+		}
+		prev = cur;
+	}
+	return NULL;
+}
+
+/* Largest segment, if len >= n */
+static FreeSeg *worstFit(int n, FreeSeg **outPrev) {
+	FreeSeg *prev = NULL;
+	FreeSeg *worst = NULL;
+
+	for (FreeSeg *cur = m->free_list; cur != NULL; cur = cur->next) {
+		if (cur->len >= n && (worst == NULL || cur->len > worst->len)) {
+			worst = cur;
+			*outPrev = prev;
+		}
+		prev = cur;
+	}
+	return worst;
+}
+
+/* Take n cells from the free list using the chosen policy.
+ * Returns the start of the block, or -1 if no segment is large enough */
+static int takeCells(int n) {
+	FreeSeg *bestPrev = NULL;
+	FreeSeg *best = fits[policy](n, &bestPrev);
 
-	// No segment large enough
 	if (best == NULL) {
-		error("Not enough memory.");
-		return MEM_ERROR;
+		return -1;
 	}
 
 	int start = best->start;
@@ -228,9 +566,221 @@ int memAlloc(int n, int *outStart) {
 		best->len -= n;
 	}
 
+	m->rover = start + n;
+	return start;
+}
+
+/* Give a block back to the shared pool */
+static int returnShared(int start, int len) {
+	FreeSeg *seg = newSeg(start, len);
+	if (seg == NULL) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+
+	pthread_mutex_lock(&m->lock);
+	insertSorted(&m->free_list, seg);
+	combine(m->free_list);
+	pthread_mutex_unlock(&m->lock);
+	return MEM_OK;
+}
+
+/* Give the blocks of cache c back to the free list, with the lock held.
+ * Returns the number of blocks given back */
+static int drainCache(Cache *c) {
+	int drained = 0;
+	FreeSeg *seg = NULL;
+
+	for (int len = 1; len <= CACHE_SIZES; len++) {
+		for (int i = 0; i < CACHE_DEPTH; i++) {
+			if (atomic_load(&c->starts[len][i]) == CACHE_EMPTY) {
+				continue;
+			}
+
+			// Without a node the block stays cached
+			if (seg == NULL && (seg = newSeg(0, len)) == NULL) {
+				return drained;
+			}
+			int start = atomic_exchange(&c->starts[len][i], CACHE_EMPTY);
+			if (start == CACHE_EMPTY) {
+				continue;
+			}
+			atomic_fetch_sub(&c->cells, len);
+			seg->start = start;
+			seg->len = len;
+			insertSorted(&m->free_list, seg);
+			seg = NULL;
+			drained++;
+		}
+	}
+
+	free(seg);
+	if (drained) {
+		combine(m->free_list);
+	}
+	return drained;
+}
+
+/* Give all blocks cached by this thread back to the shared pool, and
+ * unlink its cache from the memory */
+static void flushCache(void) {
+	if (cache.memory == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&m->lock);
+	drainCache(&cache);
+	Cache **link = &m->caches;
+	while (*link != &cache) {
+		link = &(*link)->next;
+	}
+	*link = cache.next;
+	pthread_mutex_unlock(&m->lock);
+	cache.memory = NULL;
+}
+
+/* Take a block of n cells from the cache of this thread, or return -1 */
+static int popCache(int n) {
+	for (int i = 0; i < CACHE_DEPTH; i++) {
+		if (atomic_load_explicit(&cache.starts[n][i], memory_order_relaxed) == CACHE_EMPTY) {
+			continue;
+		}
+		int start = atomic_exchange(&cache.starts[n][i], CACHE_EMPTY);
+		if (start != CACHE_EMPTY) {
+			atomic_fetch_sub(&cache.cells, n);
+			return start;
+		}
+	}
+	return -1;
+}
+
+/* Keep a freed block of n cells in the cache of this thread (1 if kept) */
+static int pushCache(int start, int n) {
+	if (n > CACHE_SIZES || atomic_load(&cache.cells) + n > m->size / CACHE_SHARE) {
+		return 0;
+	}
+
+	// Link the cache before it holds blocks, so they can be taken back
+	if (cache.memory != m) {
+		for (int len = 1; len <= CACHE_SIZES; len++) {
+			for (int i = 0; i < CACHE_DEPTH; i++) {
+				atomic_init(&cache.starts[len][i], CACHE_EMPTY);
+			}
+		}
+		atomic_init(&cache.cells, 0);
+		pthread_mutex_lock(&m->lock);
+		cache.next = m->caches;
+		m->caches = &cache;
+		pthread_mutex_unlock(&m->lock);
+		cache.memory = m;
+	}
+
+	// Other threads only empty slots, so an empty one stays free to fill
+	for (int i = 0; i < CACHE_DEPTH; i++) {
+		if (atomic_load(&cache.starts[n][i]) == CACHE_EMPTY) {
+			atomic_fetch_add(&cache.cells, n);
+			atomic_store(&cache.starts[n][i], start);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Allocate n cells of shared memory, from the cache of this thread if possible */
+static int allocShared(int n, int *outStart, int quiet) {
+	int start = -1;
+	if (n <= CACHE_SIZES && cache.memory == m) {
+		start = popCache(n);
+	}
+	if (start < 0) {
+		pthread_mutex_lock(&m->lock);
+		start = takeCells(n);
+
+		// The caches of the threads may hold the cells needed
+		if (start < 0) {
+			int drained = 0;
+			for (Cache *c = m->caches; c != NULL; c = c->next) {
+				drained += drainCache(c);
+			}
+			if (drained) {
+				start = takeCells(n);
+			}
+		}
+		pthread_mutex_unlock(&m->lock);
+	}
+
+	if (start < 0) {
+		if (!quiet) {
+			error("Not enough memory.");
+		}
+		return MEM_ERROR;
+	}
+
+	// Publish the zeroed cells only once the block is marked as allocated
+	for (int i = 0; i < n; i++) {
+		__atomic_store_n(&m->cells[start + i], 0, __ATOMIC_RELAXED);
+		atomic_store_explicit(&m->owned[start + i], 1, memory_order_release);
+	}
+
+	*outStart = start;
+	return MEM_OK;
+}
+
+/* Free a block of shared memory, into the cache of this thread if possible */
+static int freeShared(int start, int len) {
+	// Claim every cell, so that concurrent or double frees of a cell fail
+	for (int i = 0; i < len; i++) {
+		unsigned char expected = 1;
+		if (!atomic_compare_exchange_strong(&m->owned[start + i], &expected, 0)) {
+			while (i-- > 0) {
+				atomic_store(&m->owned[start + i], 1);
+			}
+			error("Wrong Memory Access.");
+			return MEM_ERROR;
+		}
+	}
+
+	if (pushCache(start, len)) {
+		return MEM_OK;
+	}
+	return returnShared(start, len);
+}
+
+/* Allocate n cells using the chosen policy (1 on success, 0 on failure).
+ * If quiet, a block that does not fit is not reported */
+static int allocCells(int n, int *outStart, int quiet) {
+	if (m == NULL || outStart == NULL) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+	if (n <= 0 || n > m->size) {
+		if (!quiet || n <= 0) {
+			error("Wrong Memory Access.");
+		}
+		return MEM_ERROR;
+	}
+	if (m->shared) {
+		return allocShared(n, outStart, quiet);
+	}
+
+	int start = takeCells(n);
+
+	// No segment large enough
+	if (start < 0) {
+		if (!quiet) {
+			error("Not enough memory.");
+		}
+		return MEM_ERROR;
+	}
+
 	// Initialise allocated cells to 0
-	for (int i = 0; i <n; i++) {
-		m->cells[start + i] = 0;
+	if (m->sparse) {
+		sparseClear(start, n);
+	}
+	else {
+		for (int i = 0; i <n; i++) {
+			m->cells[start + i] = 0;
+		}
 	}
 
 	*outStart = start;
@@ -238,7 +788,7 @@ int memAlloc(int n, int *outStart) {
 }
 
 /* Add a block to the free list and merge adjacent/overlapping segments */
-int memFreeBlock(int start, int len) {
+static int freeCells(int start, int len) {
 	if (m == NULL) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
@@ -259,13 +809,26 @@ int memFreeBlock(int start, int len) {
 	}
 
 	// Ensure entire block is allocated
-	for (int i = 0; i< len; i++) {
+	if (!m->shared && !rangeAllocated(start, len)) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+	for (int i = 0; m->shared && i < len; i++) {
 		if (isAllocated(start + i)) {
 			error("Wrong Memory Access.");
 			return MEM_ERROR;
 		}
 	}
 
+	if (m->shared) {
+		return freeShared(start, len);
+	}
+
+	// Pages no longer used are given back right away
+	if (m->sparse) {
+		sparseClear(start, len);
+	}
+
 	// Create a new free segment node for the block
 	FreeSeg *seg = newSeg(start, len);
 	if (seg == NULL) {
@@ -280,7 +843,7 @@ int memFreeBlock(int start, int len) {
 }
 
 /* Safe read of block[i] into *outValue */
-int memRead(int i, int *outValue) {
+static int readCell(int i, int *outValue) {
 	if (m == NULL || outValue == NULL) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
@@ -298,12 +861,12 @@ int memRead(int i, int *outValue) {
 		return MEM_ERROR;
 	}
 
-	*outValue = m->cells[i];
+	*outValue = cellValue(i);
 	return MEM_OK;
 }
 
 /* Safe write into block[i] */
-int memWrite(int i, int value) {
+static int writeCell(int i, int value) {
 	if (m == NULL) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
@@ -319,12 +882,21 @@ int memWrite(int i, int value) {
 		return MEM_ERROR;
 	}
 
-	m->cells[i] = value;
+	if (m->shared) {
+		__atomic_store_n(&m->cells[i], value, __ATOMIC_RELAXED);
+		return MEM_OK;
+	}
+
+	int *cell = cellForWrite(i);
+	if (cell == NULL) {
+		return MEM_ERROR;
+	}
+	*cell = value;
 	return MEM_OK;
 }
 
 /* Safe increment block[i]++ */
-int memInc(int i) {
+static int incCell(int i) {
 	if (m == NULL) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
@@ -340,12 +912,21 @@ int memInc(int i) {
 		return MEM_ERROR;
 	}
 
-	m->cells[i] += 1;
+	if (m->shared) {
+		__atomic_fetch_add(&m->cells[i], 1, __ATOMIC_RELAXED);
+		return MEM_OK;
+	}
+
+	int *cell = cellForWrite(i);
+	if (cell == NULL) {
+		return MEM_ERROR;
+	}
+	*cell += 1;
 	return MEM_OK;
 }
 
 /* Safe decrement block[i]-- */
-int memDec(int i) {
+static int decCell(int i) {
 	if (m == NULL) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
@@ -360,6 +941,586 @@ int memDec(int i) {
 		error("Wrong Memory Access.");
 		return MEM_ERROR;
 	}
-	m->cells[i] -= 1;
+	if (m->shared) {
+		__atomic_fetch_sub(&m->cells[i], 1, __ATOMIC_RELAXED);
+		return MEM_OK;
+	}
+
+	int *cell = cellForWrite(i);
+	if (cell == NULL) {
+		return MEM_ERROR;
+	}
+	*cell -= 1;
+	return MEM_OK;
+}
+
+/* Validate the cells [start, start + len) as allocated */
+static int blockOK(int start, int len) {
+	if (len <= 0 || !addrOK(start) || len > m->size - start) {
+		return 0;
+	}
+
+	if (m->shared) {
+		for (int i = start; i < start + len; i++) {
+			if (!atomic_load_explicit(&m->owned[i], memory_order_acquire)) {
+				return 0;
+			}
+		}
+		return 1;
+	}
+	return rangeAllocated(start, len);
+}
+
+/* Safe fill of block[start .. start + len) with value */
+static int fillCells(int start, int len, int value) {
+	if (m == NULL || !blockOK(start, len)) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+
+	if (m->shared) {
+		for (int i = start; i < start + len; i++) {
+			__atomic_store_n(&m->cells[i], value, __ATOMIC_RELAXED);
+		}
+		return MEM_OK;
+	}
+
+	if (!m->sparse) {
+		if (value == 0) {
+			memset(&m->cells[start], 0, (size_t)len * sizeof(int));
+		}
+		else {
+			for (int i = start; i < start + len; i++) {
+				m->cells[i] = value;
+			}
+		}
+		return MEM_OK;
+	}
+
+	// Zeroes need no pages, other values are written a page at a time
+	if (value == 0) {
+		sparseClear(start, len);
+		return MEM_OK;
+	}
+	for (int end = start + len; start < end; ) {
+		int *cell = cellForWrite(start);
+		if (cell == NULL) {
+			return MEM_ERROR;
+		}
+
+		int stop = (start | (PAGE_CELLS - 1)) + 1;
+		if (stop > end) {
+			stop = end;
+		}
+		for (int i = 0; i < stop - start; i++) {
+			cell[i] = value;
+		}
+		start = stop;
+	}
+	return MEM_OK;
+}
+
+/* Safe copy of block[src .. src + len) to block[dst .. dst + len),
+ * which may overlap */
+static int moveCells(int dst, int src, int len) {
+	if (m == NULL || !blockOK(dst, len) || !blockOK(src, len)) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+
+	if (!m->shared && !m->sparse) {
+		memmove(&m->cells[dst], &m->cells[src], (size_t)len * sizeof(int));
+		return MEM_OK;
+	}
+
+	// Cell by cell, backwards if the source lies before an overlapping destination
+	int step = dst > src ? -1 : 1;
+	for (int k = 0, i = step > 0 ? 0 : len - 1; k < len; k++, i += step) {
+		int value = cellValue(src + i);
+		if (m->shared) {
+			__atomic_store_n(&m->cells[dst + i], value, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		// Zeroes are not written to pages that do not exist
+		if (value == 0 && sparseCell(dst + i) == NULL) {
+			continue;
+		}
+		int *cell = cellForWrite(dst + i);
+		if (cell == NULL) {
+			return MEM_ERROR;
+		}
+		*cell = value;
+	}
+	return MEM_OK;
+}
+
+/* Extend the block [start, start + len) by extra cells taken from the
+ * start of the free segment right after it, if that one is large enough */
+static int growInPlace(int start, int len, int extra) {
+	int end = start + len;
+
+	if (m->shared) {
+		pthread_mutex_lock(&m->lock);
+	}
+
+	FreeSeg *prev = NULL;
+	FreeSeg *cur = m->free_list;
+	while (cur != NULL && cur->start < end) {
+		prev = cur;
+		cur = cur->next;
+	}
+
+	int fits = cur != NULL && cur->start == end && cur->len >= extra;
+	if (fits && cur->len == extra) {
+		if (prev != NULL) {
+			prev->next = cur->next;
+		}
+		else {
+			m->free_list = cur->next;
+		}
+		free(cur);
+	}
+	else if (fits) {
+		cur->start += extra;
+		cur->len -= extra;
+	}
+	if (fits) {
+		m->rover = end + extra;
+	}
+
+	if (m->shared) {
+		pthread_mutex_unlock(&m->lock);
+	}
+	if (!fits) {
+		return MEM_ERROR;
+	}
+
+	// Initialise the new cells to 0, like allocCells()
+	if (m->shared) {
+		for (int i = end; i < end + extra; i++) {
+			__atomic_store_n(&m->cells[i], 0, __ATOMIC_RELAXED);
+			atomic_store_explicit(&m->owned[i], 1, memory_order_release);
+		}
+	}
+	else if (m->sparse) {
+		sparseClear(end, extra);
+	}
+	else {
+		memset(&m->cells[end], 0, (size_t)extra * sizeof(int));
+	}
+	return MEM_OK;
+}
+
+/* Resize the block [start, start + len) to newLen cells: in place if it
+ * shrinks or the free segment after it has room, otherwise by allocating
+ * a new block, moving the cells over and freeing the old one */
+static int reallocCells(int start, int len, int newLen, int *outStart) {
+	if (m == NULL || outStart == NULL || newLen <= 0 || !blockOK(start, len)) {
+		error("Wrong Memory Access.");
+		return MEM_ERROR;
+	}
+
+	if (newLen <= len) {
+		if (newLen < len && freeCells(start + newLen, len - newLen) != MEM_OK) {
+			return MEM_ERROR;
+		}
+		*outStart = start;
+		return MEM_OK;
+	}
+
+	if (growInPlace(start, len, newLen - len) == MEM_OK) {
+		*outStart = start;
+		return MEM_OK;
+	}
+
+	int newStart;
+	if (allocCells(newLen, &newStart, 0) != MEM_OK) {
+		return MEM_ERROR;
+	}
+	if (moveCells(newStart, start, len) != MEM_OK) {
+		freeCells(newStart, newLen);
+		return MEM_ERROR;
+	}
+	freeCells(start, len);
+
+	*outStart = newStart;
+	return MEM_OK;
+}
+
+/* Monotonic clock in nanoseconds */
+static unsigned long long clockNs(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Account a checked call that started at start */
+static void account(unsigned long long start) {
+	profile->calls++;
+	profile->ns += clockNs() - start;
+}
+
+/* Write the buffered trace events to the trace file */
+static void flushTrace(void) {
+	if (trace->count && fwrite(trace->events, sizeof(MemTraceEvent), trace->count, trace->file)
+	                    != (size_t)trace->count) {
+		trace->failed = 1;
+	}
+	trace->count = 0;
+}
+
+/* Buffer an allocator event that happened at time; from and fromLen
+ * describe the block a memRealloc() resized */
+static void traceEvent(unsigned long long time, uint32_t flags, int start, int len, int from, int fromLen) {
+	unsigned long long delta = time - trace->last;
+	MemTraceEvent *event = &trace->events[trace->count++];
+
+	event->delta = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+	event->flags = flags;
+	event->start = start;
+	event->length = len;
+	event->from = from;
+	event->fromLength = fromLen;
+	trace->last = time;
+
+	if (trace->count == TRACE_BUFFER) {
+		flushTrace();
+	}
+}
+
+/* The checked accessors only pay for a test of profile (and trace) unless profiling or tracing */
+static int allocBlock(int n, int *outStart, int quiet) {
+	if (profile || trace) {
+		unsigned long long start = clockNs();
+		int status = allocCells(n, outStart, quiet);
+		if (profile) {
+			account(start);
+		}
+		if (trace) {
+			traceEvent(start, status ? MEM_TRACE_FAILED : 0, status ? -1 : *outStart, n, -1, 0);
+		}
+		return status;
+	}
+	return allocCells(n, outStart, quiet);
+}
+
+int memAlloc(int n, int *outStart) {
+	return allocBlock(n, outStart, 0);
+}
+
+int memTryAlloc(int n, int *outStart) {
+	return allocBlock(n, outStart, 1);
+}
+
+int memFreeBlock(int start, int len) {
+	if (profile || trace) {
+		unsigned long long begin = clockNs();
+		int status = freeCells(start, len);
+		if (profile) {
+			account(begin);
+		}
+		if (trace) {
+			traceEvent(begin, MEM_TRACE_FREE | (status ? MEM_TRACE_FAILED : 0), start, len, -1, 0);
+		}
+		return status;
+	}
+	return freeCells(start, len);
+}
+
+int memRealloc(int start, int len, int newLen, int *outStart) {
+	if (profile || trace) {
+		unsigned long long begin = clockNs();
+		int status = reallocCells(start, len, newLen, outStart);
+		if (profile) {
+			account(begin);
+		}
+		if (trace) {
+			traceEvent(begin, MEM_TRACE_REALLOC | (status ? MEM_TRACE_FAILED : 0),
+			           status ? -1 : *outStart, newLen, start, len);
+		}
+		return status;
+	}
+	return reallocCells(start, len, newLen, outStart);
+}
+
+int memRead(int i, int *outValue) {
+	if (profile) {
+		unsigned long long start = clockNs();
+		int status = readCell(i, outValue);
+		account(start);
+		return status;
+	}
+	return readCell(i, outValue);
+}
+
+int memWrite(int i, int value) {
+	if (profile) {
+		unsigned long long start = clockNs();
+		int status = writeCell(i, value);
+		account(start);
+		return status;
+	}
+	return writeCell(i, value);
+}
+
+int memInc(int i) {
+	if (profile) {
+		unsigned long long start = clockNs();
+		int status = incCell(i);
+		account(start);
+		return status;
+	}
+	return incCell(i);
+}
+
+int memDec(int i) {
+	if (profile) {
+		unsigned long long start = clockNs();
+		int status = decCell(i);
+		account(start);
+		return status;
+	}
+	return decCell(i);
+}
+
+int memFill(int start, int len, int value) {
+	if (profile) {
+		unsigned long long begin = clockNs();
+		int status = fillCells(start, len, value);
+		account(begin);
+		return status;
+	}
+	return fillCells(start, len, value);
+}
+
+int memMove(int dst, int src, int len) {
+	if (profile) {
+		unsigned long long start = clockNs();
+		int status = moveCells(dst, src, len);
+		account(start);
+		return status;
+	}
+	return moveCells(dst, src, len);
+}
+
+/* Start tracing the allocator calls of this thread into file */
+int memTraceStart(FILE *file) {
+	if (trace != NULL || file == NULL) {
+		return MEM_ERROR;
+	}
+
+	MemTraceHeader header = { MEM_TRACE_MAGIC, MEM_TRACE_VERSION, cellCount, sizeof(MemTraceEvent) };
+	trace = (Trace *)malloc(sizeof(Trace));
+	if (!trace || fwrite(&header, sizeof(header), 1, file) != 1) {
+		free(trace);
+		trace = NULL;
+		return MEM_ERROR;
+	}
+
+	trace->file = file;
+	trace->count = 0;
+	trace->last = clockNs();
+	trace->failed = 0;
 	return MEM_OK;
 }
+
+/* Stop tracing and write the remaining events */
+int memTraceStop(void) {
+	if (trace == NULL) {
+		return MEM_ERROR;
+	}
+
+	flushTrace();
+	int failed = trace->failed || fflush(trace->file);
+	free(trace);
+	trace = NULL;
+	return failed ? MEM_ERROR : MEM_OK;
+}
+
+/* Free cells, largest free segment, and number of free segments */
+void memStats(MemStats *stats) {
+	stats->freeCells = 0;
+	stats->largestFree = 0;
+	stats->segments = 0;
+	stats->pages = 0;
+
+	if (m == NULL) {
+		return;
+	}
+	stats->pages = m->pages;
+
+	// Blocks cached by threads count as allocated
+	if (m->shared) {
+		pthread_mutex_lock(&m->lock);
+	}
+	for (FreeSeg *cur = m->free_list; cur != NULL; cur = cur->next) {
+		stats->freeCells += cur->len;
+		stats->segments++;
+		if (cur->len > stats->largestFree) {
+			stats->largestFree = cur->len;
+		}
+	}
+	if (m->shared) {
+		pthread_mutex_unlock(&m->lock);
+	}
+}
+
+/* Make the memory of this thread safe to share with other threads */
+MemShared *memShare(void) {
+	if (memInit() != MEM_OK) {
+		return NULL;
+	}
+	if (m->shared) {
+		return m;
+	}
+	if (m->sparse) {
+		error("Sparse memory can not be shared.");
+		return NULL;
+	}
+
+	m->owned = (atomic_uchar *)malloc(m->size * sizeof(atomic_uchar));
+	if (m->owned == NULL || pthread_mutex_init(&m->lock, NULL) != 0) {
+		free(m->owned);
+		m->owned = NULL;
+		error("Not enough memory.");
+		return NULL;
+	}
+
+	// Blocks allocated so far are the cells not in the free list
+	for (int i = 0; i < m->size; i++) {
+		atomic_init(&m->owned[i], isAllocated(i) == MEM_OK);
+	}
+	m->caches = NULL;
+	atomic_init(&m->users, 1);
+	m->shared = 1;
+	return m;
+}
+
+/* Use shared memory from the calling thread */
+int memAttach(MemShared *shared) {
+	if (shared == NULL || !shared->shared || m != NULL) {
+		return MEM_ERROR;
+	}
+
+	atomic_fetch_add(&shared->users, 1);
+	m = shared;
+	return MEM_OK;
+}
+
+/* Choose the allocation policy of memAlloc() */
+int memSetPolicy(MemPolicy newPolicy) {
+	if (newPolicy < MEM_BEST_FIT || newPolicy > MEM_WORST_FIT) {
+		return MEM_ERROR;
+	}
+	policy = newPolicy;
+	return MEM_OK;
+}
+
+/* Look up a policy by its name */
+int memPolicyByName(const char *name, MemPolicy *outPolicy) {
+	for (int i = MEM_BEST_FIT; i <= MEM_WORST_FIT; i++) {
+		if (strcmp(name, policyNames[i]) == 0) {
+			*outPolicy = (MemPolicy)i;
+			return MEM_OK;
+		}
+	}
+	return MEM_ERROR;
+}
+
+/* Name of a policy */
+const char *memPolicyName(MemPolicy p) {
+	return policyNames[p];
+}
+
+/* Start or stop profiling the checked accessors */
+void memSetProfile(MemProfile *memProfile) {
+	profile = memProfile;
+}
+
+/* Unchecked read of block[i], caller guarantees i is allocated */
+int memReadUnchecked(int i) {
+	if (m->sparse) {
+		int *cell = sparseCell(i);
+		return cell ? *cell : 0;
+	}
+	return m->cells[i];
+}
+
+/* Unchecked write into block[i] */
+void memWriteUnchecked(int i, int value) {
+	int *cell = cellForWrite(i);
+	if (cell) {
+		*cell = value;
+	}
+}
+
+/* Unchecked increment block[i]++ */
+void memIncUnchecked(int i) {
+	int *cell = cellForWrite(i);
+	if (cell) {
+		*cell += 1;
+	}
+}
+
+/* Unchecked decrement block[i]-- */
+void memDecUnchecked(int i) {
+	int *cell = cellForWrite(i);
+	if (cell) {
+		*cell -= 1;
+	}
+}
+
+/* Direct pointer to block[i], caller guarantees i is allocated */
+int *memCellPointer(int i) {
+	return m->sparse ? NULL : &m->cells[i];
+}
+
+/* Checked pointer to the cells [start, start + len) */
+int *memRange(int start, int len) {
+	if (m == NULL || m->sparse || len <= 0 || !addrOK(start) || len > m->size - start) {
+		return NULL;
+	}
+
+	if (m->shared) {
+		for (int i = start; i < start + len; i++) {
+			if (!atomic_load_explicit(&m->owned[i], memory_order_acquire)) {
+				return NULL;
+			}
+		}
+		return &m->cells[start];
+	}
+
+	return rangeAllocated(start, len) ? &m->cells[start] : NULL;
+}
+
+/* Exchange the memory of this thread */
+struct Memory *memSwap(struct Memory *memory) {
+	Memory *previous = m;
+
+	// Cached blocks belong to the memory they were freed in
+	if (m != NULL && m->shared) {
+		flushCache();
+	}
+	m = memory;
+	return previous;
+}
+
+/* Choose the size of memories initialised from now on */
+int memSetCells(int cells) {
+	if (cells <= 0) {
+		return MEM_ERROR;
+	}
+	cellCount = cells;
+	return MEM_OK;
+}
+
+/* Choose whether memories initialised from now on are sparse */
+void memSetSparse(int sparse) {
+	sparseMode = sparse != 0;
+}
+
+/* Whether the memory of this thread is sparse */
+int memSparse(void) {
+	return m != NULL ? m->sparse : sparseMode;
+}
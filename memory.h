@@ -2,16 +2,69 @@
 #define MEMORY_H
 
 #include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
 
-#define MEM_CELLS 100
+#define MEM_CELLS 100           // default size, see memSetCells()
 
 #define MEM_OK 0
 #define MEM_ERROR 1
 
+/* Calls of the checked accessors and the time spent in them, see memSetProfile() */
+typedef struct MemProfile {
+    unsigned long long calls;
+    unsigned long long ns;
+} MemProfile;
+
+/* Allocator trace file, see memTraceStart(): a MemTraceHeader followed by
+ * one MemTraceEvent per call of memAlloc(), memFreeBlock() or memRealloc(),
+ * in the byte order of the machine that wrote it */
+#define MEM_TRACE_MAGIC "IPWT"
+#define MEM_TRACE_VERSION 2
+
+#define MEM_TRACE_FREE 0x1      // memFreeBlock(); memAlloc() otherwise
+#define MEM_TRACE_FAILED 0x2    // the call failed
+#define MEM_TRACE_REALLOC 0x4   // memRealloc() of from, fromLength
+
+typedef struct MemTraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t cells;             // size of the memory
+    uint32_t eventSize;         // sizeof(MemTraceEvent)
+} MemTraceHeader;
+
+typedef struct MemTraceEvent {
+    uint32_t delta;             // nanoseconds since the previous event (or the start)
+    uint32_t flags;             // MEM_TRACE_* flags
+    int32_t start;              // block freed, or block allocated (-1 if allocating failed)
+    int32_t length;             // cells allocated or freed
+    int32_t from;               // block resized by a memRealloc(), -1 otherwise
+    int32_t fromLength;         // its length before the call, 0 otherwise
+} MemTraceEvent;
+
+/* Allocation policies of memAlloc(), see memSetPolicy() */
+typedef enum MemPolicy {
+    MEM_BEST_FIT,               // smallest free segment that fits (default)
+    MEM_FIRST_FIT,              // lowest free segment that fits
+    MEM_NEXT_FIT,               // first segment that fits after the previous allocation, wrapping around
+    MEM_WORST_FIT               // largest free segment
+} MemPolicy;
+
+/* Free space of the allocator, see memStats() */
+typedef struct MemStats {
+    int freeCells;
+    int largestFree;            // length of the largest free segment
+    int segments;               // number of free segments
+    int pages;                  // pages allocated by a sparse memory, see memSetSparse()
+} MemStats;
+
+/* Memory shared among threads, see memShare() */
+typedef struct Memory MemShared;
+
 /**
  * @file memory.h
  * @brief Embedded memory with an allocator and bounds-checked access 
- * with a fixed size of 100 integer cells for the mini-language interpreter. 
+ * with a size of 100 integer cells by default for the mini-language interpreter. 
  *
  * The module manages the integer array and supports:
  *  - Allocation of blocks
@@ -19,7 +72,7 @@
  *  - Safe read, write, increase, and decrease
  *
  * Ownership:
- *  - This module owns an internal static Memory instance
+ *  - This module owns an internal static Memory instance per thread
  *  - memInit() allocates and initializes it
  *  - memFree() releases internal allocator data and Memory instance
  */
@@ -28,7 +81,7 @@
 /* @brief Initialize the module
  *
  * @pre: memory is not previously initialised
- * @post: all MEM_CELLS are set to 0. After this call, 
+ * @post: all cells are set to 0. After this call, 
  *        allocations and accesses are valid.
  *
  * @return If called when already initialized, this implementation
@@ -45,6 +98,20 @@ int memInit(void);
  */
 void memFree(void);
 
+/*
+ * @brief Free all blocks at once, keeping the memory initialised
+ *
+ * Used to reuse the memory for another program without memFree()
+ * and memInit(). Unless the memory is shared (see memShare()), the cost
+ * does not depend on the number of cells; a shared memory also clears the
+ * ownership mark of every cell, which costs O(cells).
+ *
+ * @post: All cells are free; initialises the memory if needed
+ *
+ * @return MEM_OK on success
+ */
+int memReset(void);
+
 /*
  * @brief Allocates n contiguous cells.
  *
@@ -62,6 +129,16 @@ void memFree(void);
  */
 int memAlloc(int n, int *outStart);
 
+/*
+ * @brief Allocates n contiguous cells like memAlloc(), but silently
+ *
+ * For optional blocks, e.g. scratch space the caller can do without:
+ * if no free segment is large enough, nothing is printed.
+ *
+ * @return MEM_OK on success; MEM_ERROR if the block does not fit
+ */
+int memTryAlloc(int n, int *outStart);
+
 /*
  * @brief Free a previously allocated block
  *
@@ -82,6 +159,28 @@ int memAlloc(int n, int *outStart);
  */
 int memFreeBlock(int start, int len);
 
+/*
+ * @brief Resize an allocated block, keeping its first cells
+ *
+ * Corresponds to the mini-language command: Rea x n
+ *
+ * A block that shrinks gives its last cells back. A block that grows
+ * takes the cells it needs from the free segment right after it if that
+ * one is large enough, so it stays in place. Otherwise a new block is
+ * allocated, the cells are moved over and the old block is freed. Cells
+ * added are 0.
+ *
+ * @param:  start:     first cell of the block
+ *          len:       size of the block
+ *          newLen:    size of the block after resizing
+ *          outStart:  receives the first cell of the resized block
+ *
+ * @return MEM_OK on success; MEM_ERROR, with an error message, if the
+ *         block is not allocated, newLen is not positive, or no free
+ *         segment is large enough, in which case the block is unchanged
+ */
+int memRealloc(int start, int len, int newLen, int *outStart);
+
 /*
  * @brief Safe read from an allocated block
  *
@@ -148,4 +247,205 @@ int memInc(int i);
  */
 int memDec(int i);
 
+/*
+ * @brief Safe fill of the cells [start, start + len) with value
+ *
+ * Checked once for the whole range, then written like memset(). In a
+ * sparse memory, filling with 0 releases the pages the range covers.
+ *
+ * @return MEM_OK on success; MEM_ERROR, with an error message, if len
+ *         is not positive or any cell is out of bounds or not allocated
+ */
+int memFill(int start, int len, int value);
+
+/*
+ * @brief Safe copy of the cells [src, src + len) to [dst, dst + len)
+ *
+ * Checked once for both ranges, then copied like memmove(), so the
+ * ranges may overlap.
+ *
+ * @return MEM_OK on success; MEM_ERROR, with an error message, if len
+ *         is not positive or any cell of either range is out of bounds
+ *         or not allocated
+ */
+int memMove(int dst, int src, int len);
+
+/*
+ * @brief Unchecked access to a cell of an allocated block
+ *
+ * Fast path for callers that have already proven that cell i lies
+ * inside a live allocated block (see analysis.h). No bounds or
+ * allocation checks are performed and no error is ever reported.
+ *
+ * In a sparse memory a write to a page that was never written allocates
+ * it; if that fails, the error is printed and the write is lost, so
+ * callers that must report it use the checked accessors instead.
+ *
+ * @pre:
+ *  - memory is initialised
+ *  - i is within an allocated block
+ */
+int memReadUnchecked(int i);
+void memWriteUnchecked(int i, int value);
+void memIncUnchecked(int i);
+void memDecUnchecked(int i);
+
+/*
+ * @brief Direct pointer to cell i, for callers that access a proven
+ *        allocated range without going through this module
+ *
+ * @pre: memory is initialised and i is within an allocated block
+ *
+ * @return Pointer to cell i, valid until memFree(); NULL if the memory
+ *         is sparse, as its cells are not contiguous
+ */
+int *memCellPointer(int i);
+
+/*
+ * @brief Checked direct pointer to the cells [start, start + len), for
+ *        callers that operate on a whole block at once, e.g. in parallel
+ *
+ * @return Pointer to cell start, valid until the cells are freed; NULL
+ *         if memory is uninitialised or sparse, or any of the cells is out
+ *         of bounds or not allocated. No error message is printed.
+ */
+int *memRange(int start, int len);
+
+/*
+ * @brief Make memory the memory of the calling thread and return the
+ * memory it had before, so that one thread can run several independent
+ * memories in turn, e.g. for separate interpreter contexts
+ *
+ * NULL leaves the thread without memory, as before memInit(), and is
+ * returned if it had none. The other functions of this module then act
+ * on memory until the next swap.
+ *
+ * @return The previous memory of the calling thread
+ */
+struct Memory *memSwap(struct Memory *memory);
+
+/*
+ * @brief Choose the number of cells of memories initialised from now on
+ *
+ * The size applies to all threads, so it is chosen before any start.
+ * Memories already initialised keep their size.
+ *
+ * @return MEM_OK on success; MEM_ERROR if cells is not positive
+ */
+int memSetCells(int cells);
+
+/*
+ * @brief Choose whether memories initialised from now on are sparse
+ *
+ * A sparse memory holds its cells in pages of 1024 cells, found through
+ * a two-level page table. A page is only allocated when one of its cells
+ * is first written, so reading an allocated cell that was never written
+ * returns 0. Freeing or zero-filling a range releases the pages it
+ * covers whole; the pages at its ends are only cleared, and stay until
+ * memReset(). Huge and mostly empty arrays thus take little real memory,
+ * at the cost of a table lookup per access.
+ *
+ * Sparse memories can not be shared, and as their cells are not
+ * contiguous memCellPointer() and memRange() return NULL for them. Like
+ * the size, this applies to all threads and is chosen before any start.
+ */
+void memSetSparse(int sparse);
+
+/*
+ * @brief Whether the memory of the calling thread is sparse, or the
+ *        memories initialised from now on if it has none
+ */
+int memSparse(void);
+
+/*
+ * @brief Start logging every memAlloc(), memFreeBlock(), and memRealloc()
+ * call of the calling thread to file, as described at MemTraceEvent
+ *
+ * Events are buffered and written in large blocks; the caller owns file
+ * and closes it after memTraceStop().
+ *
+ * @return MEM_OK on success; MEM_ERROR if already tracing or writing the
+ *         header failed
+ */
+int memTraceStart(FILE *file);
+
+/*
+ * @brief Write the buffered events and stop tracing
+ *
+ * @return MEM_OK on success; MEM_ERROR if not tracing or writing any
+ *         event failed
+ */
+int memTraceStop(void);
+
+/*
+ * @brief Choose the policy memAlloc() uses to pick a free segment
+ *
+ * The policy applies to all threads, so it is chosen before any start.
+ * memFreeBlock() and the other accessors do not depend on it.
+ *
+ * @return MEM_OK on success; MEM_ERROR if policy is unknown
+ */
+int memSetPolicy(MemPolicy policy);
+
+/*
+ * @brief Look up a policy by its name: best, first, next, or worst
+ *
+ * @return MEM_OK on success; MEM_ERROR if name is unknown
+ */
+int memPolicyByName(const char *name, MemPolicy *outPolicy);
+
+/*
+ * @brief Name of policy, as accepted by memPolicyByName()
+ */
+const char *memPolicyName(MemPolicy policy);
+
+/*
+ * @brief Report the free space of the memory of the calling thread
+ *
+ * Fragmentation is 1 - largestFree / freeCells.
+ */
+void memStats(MemStats *stats);
+
+/*
+ * @brief Make the memory of the calling thread safe to share with other
+ * threads, initialising it if needed
+ *
+ * From then on memAlloc() and memFreeBlock() take blocks from a pool
+ * behind a lock, but each thread keeps up to a few freed blocks of every
+ * small size, at most a sixteenth of the cells, for its own next
+ * allocations, which do not lock. An allocation that finds no free
+ * segment takes back the blocks kept by all threads first. The checked
+ * accessors use atomic cell operations, so concurrent memInc() and memDec()
+ * of a cell are not lost. The unchecked accessors and memCellPointer()
+ * stay plain and are only safe on blocks no other thread writes.
+ *
+ * Other threads use the memory after memAttach(). Every thread, including
+ * the calling one, calls memFree() when done; the last one releases it.
+ * memReset() is only allowed while no other thread is attached.
+ *
+ * @return The shared memory; NULL if allocating failed
+ */
+MemShared *memShare(void);
+
+/*
+ * @brief Use shared memory from the calling thread
+ *
+ * @pre: the calling thread has no memory of its own
+ *
+ * @return MEM_OK on success; MEM_ERROR if shared was not made by
+ *         memShare() or the thread already has memory
+ */
+int memAttach(MemShared *shared);
+
+/*
+ * @brief Account the calls of memAlloc(), memFreeBlock(), memRealloc(),
+ * memRead(), memWrite(), memInc(), memDec(), memFill(), and memMove() of
+ * the calling thread and the time spent in them to profile, or stop
+ * accounting if profile is NULL.
+ *
+ * The unchecked accessors are never accounted, as timing them would
+ * cost more than they do.
+ */
+void memSetProfile(MemProfile *profile);
+
 #endif
@@ -0,0 +1,80 @@
+// memtests/testlib.c
+#include <stdio.h>
+#include <string.h>
+#include "ipwash.h"
+
+static const char program[] =
+    "Mal a 3\n"
+    "Inc a 1\n"
+    "Pra a\n"
+    "Pri a 1\n"
+    "Pri a 3\n"
+    "Pri a 0\n";
+
+static void ok(const char *msg) {
+    printf("[ OK ] %s\n", msg);
+}
+
+static void fail(const char *msg, int rc) {
+    printf("[FAIL] %s (rc=%d)\n", msg, rc);
+}
+
+static void expect_status(const char *msg, IpwStatus status, IpwStatus expected) {
+    if (status == expected) ok(msg);
+    else fail(msg, status);
+}
+
+int main(void) {
+    char data[64];
+    IpwOutput output = { data, sizeof(data), 0 };
+    IpwError error;
+
+    printf("=== test_lib: programs run through libipwash ===\n");
+
+    IpwContext *context = ipwCreate(NULL);
+    printf("ipwCreate() is %s (expected set)\n", context ? "set" : "NULL");
+
+    // The program prints, then fails at line 5, which stops it
+    expect_status("ipwExecute(program)", ipwExecute(context, program, strlen(program), &output, &error),
+                  IPW_ERROR_LINE);
+    printf("output %s (expected matches)\n",
+           strcmp(output.data, "[ 0 1 0 ]\n1\n") ? "differs" : "matches");
+    printf("length = %zu (expected 12)\n", output.length);
+    printf("line = %d (expected 5)\n", error.line);
+    printf("message = \"%s\" (expected \"Wrong Memory Access.\")\n", error.message);
+
+    // Each run starts from an empty memory, so a is allocated again
+    expect_status("ipwExecute(program, 4 lines)", ipwExecute(context, program, 30, &output, &error), IPW_OK);
+    printf("line = %d (expected 0)\n", error.line);
+    printf("message = \"%s\" (expected \"\")\n", error.message);
+
+    // Output that does not fit is cut, but its whole length is reported
+    output.size = 5;
+    expect_status("ipwExecute(program, 5 bytes of output)",
+                  ipwExecute(context, program, strlen(program), &output, &error), IPW_ERROR_LINE);
+    printf("output = \"%s\" (expected \"[ 0 \")\n", output.data);
+    printf("length = %zu (expected 12)\n", output.length);
+
+    output.size = 0;
+    expect_status("ipwExecute(program, no room)",
+                  ipwExecute(context, program, strlen(program), &output, &error), IPW_ERROR_LINE);
+    printf("length = %zu (expected 12)\n", output.length);
+    ipwDestroy(context);
+
+    IpwOptions options = { 1, 1 };
+    context = ipwCreate(&options);
+    output.size = sizeof(data);
+    expect_status("ipwExecute(program, jit and early free)",
+                  ipwExecute(context, program, strlen(program), &output, &error), IPW_ERROR_LINE);
+    printf("output %s (expected matches)\n",
+           strcmp(output.data, "[ 0 1 0 ]\n1\n") ? "differs" : "matches");
+    printf("line = %d (expected 5)\n", error.line);
+    ipwDestroy(context);
+
+    expect_status("ipwExecute(no context)", ipwExecute(NULL, program, strlen(program), &output, &error),
+                  IPW_ERROR_ARGUMENT);
+
+    printf("Done.\n");
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+// memtests/testrealloc.c
+#include <stdio.h>
+#include <string.h>
+#include "memory.h"
+#include "output.h"
+
+static void ok(const char *msg) {
+    printf("[ OK ] %s\n", msg);
+}
+
+static void fail(const char *msg, int rc) {
+    printf("[FAIL] %s (rc=%d)\n", msg, rc);
+}
+
+static void expect_ok(const char *msg, int rc) {
+    if (rc == MEM_OK) ok(msg);
+    else fail(msg, rc);
+}
+
+static void expect_error(const char *msg, int rc) {
+    if (rc != MEM_OK) ok(msg);
+    else fail(msg, rc);
+}
+
+static int cell(int i) {
+    int v = -1;
+    memRead(i, &v);
+    return v;
+}
+
+int main(void) {
+    int A = -1, B = -1, C = -1, R = -1;
+    int v = -1;
+    MemTraceHeader header;
+    MemTraceEvent event;
+
+    // Errors of the memory module go to the same stream as the results
+    setStreams(NULL, stdout);
+
+    printf("=== test_realloc: resizing blocks in place or by moving them ===\n");
+
+    FILE *trace = tmpfile();
+    expect_ok("memInit()", memInit());
+    expect_ok("memTraceStart()", trace ? memTraceStart(trace) : MEM_ERROR);
+
+    // A, B, and C side by side, then a hole where B was
+    expect_ok("memAlloc(A=10)", memAlloc(10, &A));
+    expect_ok("memAlloc(B=10)", memAlloc(10, &B));
+    expect_ok("memAlloc(C=10)", memAlloc(10, &C));
+    printf("A, B, C start = %d, %d, %d (expected 0, 10, 20)\n", A, B, C);
+    expect_ok("memFill(A, 10, 3)", memFill(A, 10, 3));
+    expect_ok("memFreeBlock(B,10)", memFreeBlock(B, 10));
+
+    // Growing into the free segment right after A keeps it in place
+    expect_ok("memRealloc(A,10,15)", memRealloc(A, 10, 15, &R));
+    printf("A start = %d (expected %d)\n", R, A);
+    printf("A[9], A[10], A[14] = %d, %d, %d (expected 3, 0, 0)\n", cell(R + 9), cell(R + 10), cell(R + 14));
+
+    // Growing past C moves A behind it
+    expect_ok("memRealloc(A,15,25)", memRealloc(R, 15, 25, &R));
+    printf("A start = %d (expected 30)\n", R);
+    printf("A[0], A[9], A[24] = %d, %d, %d (expected 3, 3, 0)\n", cell(R + 0), cell(R + 9), cell(R + 24));
+    expect_error("memRead(0) of the old block", memRead(0, &v));
+
+    // Shrinking stays in place and gives the last cells back
+    expect_ok("memRealloc(A,25,5)", memRealloc(R, 25, 5, &R));
+    printf("A start = %d (expected 30)\n", R);
+    expect_error("memRead(A+5) after shrinking", memRead(R + 5, &v));
+
+    // Failures leave the block unchanged
+    expect_error("memRealloc(A,5,1000) too large", memRealloc(R, 5, 1000, &v));
+    expect_error("memRealloc(A,5,0)", memRealloc(R, 5, 0, &v));
+    expect_error("memRealloc(0,10,20) not allocated", memRealloc(0, 10, 20, &v));
+    printf("A[4] = %d (expected 3)\n", cell(R + 4));
+
+    expect_ok("memFreeBlock(A,5)", memFreeBlock(R, 5));
+    expect_ok("memTraceStop()", memTraceStop());
+
+    // Every resize is one realloc event naming the block it resized
+    rewind(trace);
+    if (fread(&header, sizeof(header), 1, trace) == 1 && !memcmp(header.magic, MEM_TRACE_MAGIC, 4)) {
+        printf("trace version = %u (expected %d)\n", header.version, MEM_TRACE_VERSION);
+    }
+    while (fread(&event, sizeof(event), 1, trace) == 1) {
+        printf("%-7s%s start %3d length %4d from %3d length %2d\n",
+               event.flags & MEM_TRACE_REALLOC ? "realloc" : event.flags & MEM_TRACE_FREE ? "free" : "alloc",
+               event.flags & MEM_TRACE_FAILED ? " failed" : "      ",
+               event.start, event.length, event.from, event.fromLength);
+    }
+    fclose(trace);
+
+    printf("Calling memFree()...\n");
+    memFree();
+    printf("Done.\n");
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+// memtests/testshared.c
+#include <stdio.h>
+#include <pthread.h>
+#include "memory.h"
+#include "output.h"
+
+#define THREADS 4
+#define ROUNDS 10000
+
+static void ok(const char *msg) {
+    printf("[ OK ] %s\n", msg);
+}
+
+static void fail(const char *msg, int rc) {
+    printf("[FAIL] %s (rc=%d)\n", msg, rc);
+}
+
+static void expect_ok(const char *msg, int rc) {
+    if (rc == MEM_OK) ok(msg);
+    else fail(msg, rc);
+}
+
+static MemShared *shared;
+static int counter;
+static pthread_barrier_t barrier;
+
+/* Increments the shared counter while allocating, using, and freeing blocks
+ * of its own; returns the number of calls that failed */
+static void *worker(void *argument) {
+    long failed = memAttach(shared) != MEM_OK;
+    int id = (int)(long)argument;
+
+    for (int i = 0; i < ROUNDS && !failed; i++) {
+        int start = -1, v = -1;
+        failed += memInc(counter) != MEM_OK;
+        failed += memAlloc(1 + i % 3, &start) != MEM_OK;
+        failed += memWrite(start, id) != MEM_OK;
+        failed += memRead(start, &v) != MEM_OK || v != id;
+        failed += memFreeBlock(start, 1 + i % 3) != MEM_OK;
+    }
+
+    memFree();
+    return (void *)failed;
+}
+
+/* Frees four blocks of 2 cells, of which it may only keep three, and stays
+ * attached while the main thread needs their cells */
+static void *keeper(void *argument) {
+    int starts[4];
+
+    (void)argument;
+    memAttach(shared);
+    for (int i = 0; i < 4; i++) {
+        memAlloc(2, &starts[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        memFreeBlock(starts[i], 2);
+    }
+
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+    memFree();
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[THREADS];
+    MemStats stats;
+    int v = -1;
+
+    setStreams(NULL, stdout);
+
+    printf("=== test_shared: one memory used by %d threads ===\n", THREADS);
+
+    shared = memShare();
+    printf("memShare() is %s (expected set)\n", shared ? "set" : "NULL");
+    expect_ok("memAlloc(counter=1)", memAlloc(1, &counter));
+
+    for (long t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, worker, (void *)(t + 1));
+    }
+
+    long failed = 0;
+    for (int t = 0; t < THREADS; t++) {
+        void *result;
+        pthread_join(threads[t], &result);
+        failed += (long)result;
+    }
+    printf("failed calls = %ld (expected 0)\n", failed);
+
+    // No increment is lost, and the blocks of the threads are all back
+    expect_ok("memRead(counter)", memRead(counter, &v));
+    printf("counter = %d (expected %d)\n", v, THREADS * ROUNDS);
+    memStats(&stats);
+    printf("free cells = %d (expected %d)\n", stats.freeCells, MEM_CELLS - 1);
+
+    // Only this thread is left, so the memory may be reset
+    expect_ok("memReset()", memReset());
+    memStats(&stats);
+    printf("free cells = %d (expected %d)\n", stats.freeCells, MEM_CELLS);
+    expect_ok("memAlloc(A=100)", memAlloc(MEM_CELLS, &v));
+    expect_ok("memFreeBlock(A)", memFreeBlock(v, MEM_CELLS));
+
+    // Cached blocks count as allocated, and the cache of another thread is
+    // taken back when the memory runs out
+    pthread_t thread;
+    pthread_barrier_init(&barrier, NULL, 2);
+    pthread_create(&thread, NULL, keeper, NULL);
+    pthread_barrier_wait(&barrier);
+    memStats(&stats);
+    printf("free cells = %d (expected %d)\n", stats.freeCells, MEM_CELLS - MEM_CELLS / 16);
+    expect_ok("memAlloc(A=100)", memAlloc(MEM_CELLS, &v));
+    expect_ok("memFreeBlock(A)", memFreeBlock(v, MEM_CELLS));
+    pthread_barrier_wait(&barrier);
+    pthread_join(thread, NULL);
+    pthread_barrier_destroy(&barrier);
+
+    printf("Calling memFree()...\n");
+    memFree();
+    printf("Done.\n");
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+// memtests/testsparse.c
+#include <stdio.h>
+#include "memory.h"
+#include "output.h"
+
+static void ok(const char *msg) {
+    printf("[ OK ] %s\n", msg);
+}
+
+static void fail(const char *msg, int rc) {
+    printf("[FAIL] %s (rc=%d)\n", msg, rc);
+}
+
+static void expect_ok(const char *msg, int rc) {
+    if (rc == MEM_OK) ok(msg);
+    else fail(msg, rc);
+}
+
+static void expect_error(const char *msg, int rc) {
+    if (rc != MEM_OK) ok(msg);
+    else fail(msg, rc);
+}
+
+static int pages(void) {
+    MemStats stats;
+    memStats(&stats);
+    return stats.pages;
+}
+
+int main(void) {
+    int A = -1, B = -1;
+    int v = -1;
+
+    // Errors of the memory module go to the same stream as the results
+    setStreams(NULL, stdout);
+
+    printf("=== test_sparse: pages materialised on first write ===\n");
+
+    memSetSparse(1);
+    expect_ok("memSetCells(1000000000)", memSetCells(1000000000));
+    expect_ok("memInit()", memInit());
+    printf("memSparse() = %d (expected 1)\n", memSparse());
+
+    // A huge block, of whole pages of 1024 cells, takes no pages until it is written
+    expect_ok("memAlloc(A=899999744)", memAlloc(899999744, &A));
+    printf("A start = %d (expected 0)\n", A);
+    printf("pages = %d (expected 0)\n", pages());
+
+    expect_ok("memRead(A+123456789)", memRead(A + 123456789, &v));
+    printf("A[123456789] = %d (expected 0)\n", v);
+    printf("pages = %d (expected 0)\n", pages());
+
+    // Writes far apart each materialise one page
+    expect_ok("memWrite(A+0, 5)", memWrite(A + 0, 5));
+    expect_ok("memInc(A+899999743)", memInc(A + 899999743));
+    expect_ok("memDec(A+500000000)", memDec(A + 500000000));
+    printf("pages = %d (expected 3)\n", pages());
+
+    expect_ok("memRead(A+0)", memRead(A + 0, &v));
+    printf("A[0] = %d (expected 5)\n", v);
+    expect_ok("memRead(A+899999743)", memRead(A + 899999743, &v));
+    printf("A[899999743] = %d (expected 1)\n", v);
+    expect_ok("memRead(A+500000000)", memRead(A + 500000000, &v));
+    printf("A[500000000] = %d (expected -1)\n", v);
+
+    // The unchecked accessors see the same cells
+    memWriteUnchecked(A + 1, 7);
+    memIncUnchecked(A + 1);
+    printf("A[1] unchecked = %d (expected 8)\n", memReadUnchecked(A + 1));
+    printf("pages = %d (expected 3)\n", pages());
+
+    // The cells are not contiguous
+    printf("memCellPointer(A) is %s (expected NULL)\n", memCellPointer(A) ? "set" : "NULL");
+    printf("memRange(A, 10) is %s (expected NULL)\n", memRange(A, 10) ? "set" : "NULL");
+
+    // Filling and moving work page by page
+    expect_ok("memFill(A+1023, 3, 9)", memFill(A + 1023, 3, 9));
+    printf("pages = %d (expected 4)\n", pages());
+    expect_ok("memMove(A+700000000, A+1023, 3)", memMove(A + 700000000, A + 1023, 3));
+    expect_ok("memRead(A+700000002)", memRead(A + 700000002, &v));
+    printf("A[700000002] = %d (expected 9)\n", v);
+    printf("pages = %d (expected 5)\n", pages());
+
+    // Filling with 0 releases whole pages instead of writing them
+    expect_ok("memFill(A+0, 1024, 0)", memFill(A + 0, 1024, 0));
+    printf("pages = %d (expected 4)\n", pages());
+    expect_ok("memRead(A+1023)", memRead(A + 1023, &v));
+    printf("A[1023] = %d (expected 0)\n", v);
+    expect_ok("memRead(A+1024)", memRead(A + 1024, &v));
+    printf("A[1024] = %d (expected 9)\n", v);
+
+    // Accesses outside the blocks are still checked
+    expect_error("memRead(950000000) outside any block", memRead(950000000, &v));
+    expect_error("memWrite(-1, 1)", memWrite(-1, 1));
+
+    // Freeing releases the pages of the block, and a new block reads as 0
+    expect_ok("memFreeBlock(A,899999744)", memFreeBlock(A, 899999744));
+    printf("pages = %d (expected 0)\n", pages());
+    expect_ok("memAlloc(B=1000)", memAlloc(1000, &B));
+    expect_ok("memRead(B+0)", memRead(B + 0, &v));
+    printf("B[0] = %d (expected 0)\n", v);
+
+    // Resetting releases all pages at once
+    expect_ok("memWrite(B+999, 4)", memWrite(B + 999, 4));
+    printf("pages = %d (expected 1)\n", pages());
+    expect_ok("memReset()", memReset());
+    printf("pages = %d (expected 0)\n", pages());
+
+    printf("Calling memFree()...\n");
+    memFree();
+    printf("Done.\n");
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include "output.h"
+
+// Sinks of the calling thread; NULL means the standard stream
+static _Thread_local FILE *out = NULL;
+static _Thread_local FILE *err = NULL;
+
+FILE *outStream(void)
+{
+    return out ? out : stdout;
+}
+
+
+FILE *errStream(void)
+{
+    return err ? err : stderr;
+}
+
+
+void setStreams(FILE *newOut, FILE *newErr)
+{
+    out = newOut;
+    err = newErr;
+}
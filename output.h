@@ -0,0 +1,22 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+
+/* Sinks for everything the interpreter prints. Each thread has its own pair of sinks, so several 
+programs can run concurrently in one process (e.g. in batch mode) with separate output. By default 
+they are the standard output and standard error streams */
+
+/* EFFECT: Returns the sink for printed values of the calling thread
+OUTPUT: The stream to print values to */
+FILE *outStream(void);
+
+/* EFFECT: Returns the sink for error messages of the calling thread
+OUTPUT: The stream to print error messages to */
+FILE *errStream(void);
+
+/* EFFECT: Redirects the output of the calling thread to _out_ and its error messages to _err_. NULL
+restores the standard output or standard error stream respectively */
+void setStreams(FILE *out, FILE *err);
+
+#endif
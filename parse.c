@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "parse.h"
+#include "program.h"
+
+/* A newline-aligned part of the source and the program decoded from it */
+typedef struct Chunk
+{
+    const char *data;
+    size_t size;
+    Program program;
+    int lines;          // number of lines in the chunk
+    int failed;
+} Chunk;
+
+// Local functions
+void *parseChunk(void *argument);
+
+void *parseChunk(void *argument)
+{
+    /* Local function
+    EFFECT: Decodes the lines of the chunk _argument_ into its program, numbering them from 1
+    OUTPUT: NULL */
+
+    Chunk *chunk = argument;
+    const char *data = chunk->data;
+    const char *end = data + chunk->size;
+
+    while (data < end && !chunk->failed)
+    {
+        const char *nl = memchr(data, '\n', end - data);
+        const char *lineEnd = nl ? nl : end;
+
+        chunk->lines++;
+        chunk->failed = programAddLine(&chunk->program, data, lineEnd - data, chunk->lines);
+        data = nl ? nl + 1 : end;
+    }
+
+    return NULL;
+}
+
+
+int parseParallel(Program *program, const char *data, size_t size, int threads)
+{
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    Chunk *chunks = calloc(threads, sizeof(Chunk));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    if (!chunks || !ids)
+    {
+        free(chunks);
+        free(ids);
+        return 1;
+    }
+
+    // Cut the source into about equal chunks, moving every cut to just after the next newline
+    const char *start = data;
+    const char *end = data + size;
+    int count = 0;
+    while (start < end && count < threads)
+    {
+        const char *cut = count == threads - 1 ? end : start + (end - start) / (threads - count);
+        const char *nl = cut < end ? memchr(cut, '\n', end - cut) : NULL;
+        cut = nl ? nl + 1 : end;
+
+        chunks[count].data = start;
+        chunks[count].size = cut - start;
+        programInit(&chunks[count].program);
+        count++;
+        start = cut;
+    }
+
+    // The first chunk is decoded by the calling thread
+    int started = 1;
+    for (; started < count; started++)
+    {
+        if (pthread_create(&ids[started], NULL, parseChunk, &chunks[started]))
+        {
+            break;
+        }
+    }
+    parseChunk(&chunks[0]);
+
+    int error = started < count;
+    for (int i = 1; i < started; i++)
+    {
+        pthread_join(ids[i], NULL);
+    }
+
+    int lineOffset = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!error && (chunks[i].failed || programMerge(program, &chunks[i].program, lineOffset)))
+        {
+            error = 1;
+        }
+        programFree(&chunks[i].program);
+        lineOffset += chunks[i].lines;
+    }
+
+    free(chunks);
+    free(ids);
+
+    return error;
+}
@@ -0,0 +1,18 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stddef.h>
+#include "program.h"
+
+// Sources smaller than this are decoded by the calling thread alone
+#define PARALLEL_PARSE_SIZE (4 * 1024 * 1024)
+
+/* EFFECT: Decodes the _size_ characters of source at _data_ into the empty _program_ using up to 
+_threads_ threads. The source is split into chunks that end at newlines, every chunk is decoded into a 
+program of its own with its own identifier table, and the chunks are merged in source order, so 
+_program_ is the same as when decoding line by line, including the line numbers
+OUTPUT: 0 upon successful execution of the function; 1 if allocating memory or starting the threads 
+failed */
+int parseParallel(Program *program, const char *data, size_t size, int threads);
+
+#endif
@@ -0,0 +1,506 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "interpreter.h"
+#include "output.h"
+#include "pipeline.h"
+#include "program.h"
+#include "ring.h"
+
+// Size and number of the blocks the reader fills
+#define BLOCK_SIZE 65536
+#define BLOCK_COUNT 8
+
+// Capacity of the ring of decoded lines
+#define DECODED_COUNT 1024
+
+// Attempts on a full or empty ring spent spinning, then yielding the processor, before sleeping
+#define SPIN_LIMIT 64
+#define YIELD_LIMIT 128
+
+// Operators that only occur in the ring of decoded lines, ending the program
+#define PIPE_END -1             // end of the input
+#define PIPE_NO_MEMORY -2       // decoding failed for lack of memory
+#define PIPE_READ_ERROR -3      // reading the input failed
+
+/* A block of input handed from the reader to the decoder */
+typedef struct Block
+{
+    int index;          // index of the block in the pool
+    ssize_t size;       // number of characters read; 0 at the end of the input, -1 if reading failed
+} Block;
+
+/* A decoded line handed from the decoder to the executor */
+typedef struct Decoded
+{
+    Instruction instruction;
+    const char *name1;  // identifiers, owned by the identifier table of the decoder
+    const char *name2;
+    int32_t operands[3]; // of OP_FIL and OP_CPY instructions
+    char *text;         // source line of OP_RAW instructions, freed by the executor
+} Decoded;
+
+/* State shared by the stages */
+typedef struct Pipeline
+{
+    int fd;
+    char *blocks;       // pool of BLOCK_COUNT blocks
+    Ring empty;         // indices of blocks ready to be filled, from the decoder to the reader
+    Ring full;          // filled blocks, from the reader to the decoder
+    Ring decoded;       // decoded lines, from the decoder to the executor
+    atomic_int stop;    // set by the executor when it stops early
+    pthread_mutex_t lock;   // protects the waits on _moved_
+    pthread_cond_t moved;   // broadcast when an element was pushed or popped while a stage sleeps
+    atomic_int sleeping;    // number of stages waiting on _moved_
+
+    // Decoder only
+    Program names;      // identifier table; the identifiers stay in place while it grows
+    char *carry;        // start of a line continued in the next block
+    size_t carryLength;
+    size_t carryCapacity;
+    int line;
+} Pipeline;
+
+// Local functions
+int transfer(Ring *ring, const void *in, void *out);
+void wake(Pipeline *pipeline);
+int sleepTransfer(Pipeline *pipeline, Ring *ring, const void *in, void *out);
+int waitTransfer(Pipeline *pipeline, Ring *ring, const void *in, void *out);
+int waitPush(Pipeline *pipeline, Ring *ring, const void *element);
+int waitPop(Pipeline *pipeline, Ring *ring, void *element);
+void *readBlocks(void *argument);
+int emitLine(Pipeline *pipeline, const char *line, size_t length);
+int emitEnd(Pipeline *pipeline, int op);
+int appendCarry(Pipeline *pipeline, const char *data, size_t length);
+void *decodeBlocks(void *argument);
+
+int transfer(Ring *ring, const void *in, void *out)
+{
+    /* Local function
+    EFFECT: Pushes _in_ to _ring_ if it is given, and pops the first element of _ring_ into _out_ otherwise
+    OUTPUT: 0 upon successful execution of the function; 1 if _ring_ is full or empty */
+
+    return in ? ringPush(ring, in) : ringPop(ring, out);
+}
+
+
+void wake(Pipeline *pipeline)
+{
+    /* Local function
+    EFFECT: Wakes the sleeping stages after an element was pushed or popped; only takes the lock if a
+    stage sleeps */
+
+    // Orders the ring update before the check, see sleepTransfer()
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pipeline->sleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&pipeline->lock);
+        pthread_cond_broadcast(&pipeline->moved);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+}
+
+
+int sleepTransfer(Pipeline *pipeline, Ring *ring, const void *in, void *out)
+{
+    /* Local function
+    EFFECT: Pushes _in_ to _ring_ or pops its first element into _out_, see transfer(), sleeping until the
+    other end of a ring moves while _ring_ is full or empty
+    OUTPUT: 0 upon successful execution of the function; 1 if the pipeline was stopped */
+
+    // The reader is cancelled at the end, which must not leave the lock held
+    int cancel;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel);
+
+    // Announce the sleep before trying again, so that wake() either sees a sleeper or the attempt sees
+    // its element
+    pthread_mutex_lock(&pipeline->lock);
+    atomic_fetch_add(&pipeline->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    int failed;
+    while ((failed = transfer(ring, in, out)) && !atomic_load(&pipeline->stop))
+    {
+        pthread_cond_wait(&pipeline->moved, &pipeline->lock);
+    }
+    atomic_fetch_sub(&pipeline->sleeping, 1);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    pthread_setcancelstate(cancel, NULL);
+
+    return failed;
+}
+
+
+int waitTransfer(Pipeline *pipeline, Ring *ring, const void *in, void *out)
+{
+    /* Local function
+    EFFECT: Pushes _in_ to _ring_ or pops its first element into _out_, see transfer(), waiting while 
+    _ring_ is full or empty: spinning at first, then yielding the processor, and finally sleeping
+    OUTPUT: 0 upon successful execution of the function; 1 if the pipeline was stopped */
+
+    int spins = 0;
+    while (transfer(ring, in, out))
+    {
+        if (atomic_load_explicit(&pipeline->stop, memory_order_relaxed))
+        {
+            return 1;
+        }
+
+        if (++spins > YIELD_LIMIT)
+        {
+            if (sleepTransfer(pipeline, ring, in, out))
+            {
+                return 1;
+            }
+            break;
+        }
+        if (spins > SPIN_LIMIT)
+        {
+            sched_yield();
+        }
+    }
+
+    wake(pipeline);
+
+    return 0;
+}
+
+
+int waitPush(Pipeline *pipeline, Ring *ring, const void *element)
+{
+    /* Local function
+    EFFECT: Pushes _element_ to _ring_, waiting while it is full
+    OUTPUT: 0 upon successful execution of the function; 1 if the pipeline was stopped */
+
+    return waitTransfer(pipeline, ring, element, NULL);
+}
+
+
+int waitPop(Pipeline *pipeline, Ring *ring, void *element)
+{
+    /* Local function
+    EFFECT: Pops the first element of _ring_ into _element_, waiting while _ring_ is empty
+    OUTPUT: 0 upon successful execution of the function; 1 if the pipeline was stopped */
+
+    return waitTransfer(pipeline, ring, NULL, element);
+}
+
+
+void *readBlocks(void *argument)
+{
+    /* Local function
+    EFFECT: Reader stage: fills empty blocks from the input and hands them to the decoder until the 
+    input ends or the pipeline is stopped
+    OUTPUT: NULL */
+
+    Pipeline *pipeline = argument;
+    Block block;
+
+    for (;;)
+    {
+        if (waitPop(pipeline, &pipeline->empty, &block.index))
+        {
+            return NULL;
+        }
+
+        do
+        {
+            block.size = read(pipeline->fd, pipeline->blocks + (size_t) block.index * BLOCK_SIZE, BLOCK_SIZE);
+        } while (block.size < 0 && errno == EINTR);
+
+        if (waitPush(pipeline, &pipeline->full, &block) || block.size <= 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+
+int emitLine(Pipeline *pipeline, const char *line, size_t length)
+{
+    /* Local function
+    EFFECT: Decodes the _length_ characters of the next line at _line_ and hands it to the executor. 
+    Empty lines are skipped
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed or the 
+    pipeline was stopped */
+
+    Decoded decoded = { { OP_RAW, 0, -1, -1, 0, ++pipeline->line }, NULL, NULL, { 0, 0, 0 }, NULL };
+    Token name1;
+    Token name2;
+
+    int status = decodeLine(line, length, &decoded.instruction, &name1, &name2, decoded.operands);
+    if (status == 1)
+    {
+        return 0;
+    }
+
+    if (status == 2)
+    {
+        decoded.instruction.op = OP_RAW;
+        decoded.text = strndup(line, length);
+        status = decoded.text ? 2 : 3;
+    }
+    else if (!status)
+    {
+        int slot1 = programIntern(&pipeline->names, name1.text, name1.length);
+        int slot2 = name2.text ? programIntern(&pipeline->names, name2.text, name2.length) : -1;
+        if (slot1 < 0 || (name2.text && slot2 < 0))
+        {
+            status = 3;
+        }
+        else
+        {
+            decoded.name1 = pipeline->names.names[slot1];
+            decoded.name2 = slot2 >= 0 ? pipeline->names.names[slot2] : NULL;
+        }
+    }
+
+    if (status == 3)
+    {
+        decoded.instruction.op = PIPE_NO_MEMORY;
+    }
+
+    if (waitPush(pipeline, &pipeline->decoded, &decoded))
+    {
+        free(decoded.text);
+        return 1;
+    }
+
+    return status == 3;
+}
+
+
+int emitEnd(Pipeline *pipeline, int op)
+{
+    /* Local function
+    EFFECT: Tells the executor that the program ends, for the reason given by the pseudo-operator _op_
+    OUTPUT: 1 */
+
+    Decoded decoded = { { op, 0, -1, -1, 0, pipeline->line }, NULL, NULL, { 0, 0, 0 }, NULL };
+    waitPush(pipeline, &pipeline->decoded, &decoded);
+
+    return 1;
+}
+
+
+int appendCarry(Pipeline *pipeline, const char *data, size_t length)
+{
+    /* Local function
+    EFFECT: Appends the _length_ characters at _data_ to the line continued in the next block
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+
+    if (pipeline->carryLength + length > pipeline->carryCapacity)
+    {
+        size_t capacity = pipeline->carryCapacity ? pipeline->carryCapacity : BLOCK_SIZE;
+        while (capacity < pipeline->carryLength + length)
+        {
+            capacity *= 2;
+        }
+
+        char *carry = realloc(pipeline->carry, capacity);
+        if (!carry)
+        {
+            return 1;
+        }
+        pipeline->carry = carry;
+        pipeline->carryCapacity = capacity;
+    }
+
+    memcpy(pipeline->carry + pipeline->carryLength, data, length);
+    pipeline->carryLength += length;
+
+    return 0;
+}
+
+
+void *decodeBlocks(void *argument)
+{
+    /* Local function
+    EFFECT: Decoder stage: splits the filled blocks into lines, decodes them, hands them to the executor,
+    and returns the blocks to the reader, until the input ends or the pipeline is stopped
+    OUTPUT: NULL */
+
+    Pipeline *pipeline = argument;
+    Block block;
+
+    for (;;)
+    {
+        if (waitPop(pipeline, &pipeline->full, &block))
+        {
+            return NULL;
+        }
+
+        if (block.size < 0)
+        {
+            emitEnd(pipeline, PIPE_READ_ERROR);
+            return NULL;
+        }
+
+        // Last line without trailing newline
+        if (block.size == 0)
+        {
+            if (!pipeline->carryLength || !emitLine(pipeline, pipeline->carry, pipeline->carryLength))
+            {
+                emitEnd(pipeline, PIPE_END);
+            }
+            return NULL;
+        }
+
+        const char *data = pipeline->blocks + (size_t) block.index * BLOCK_SIZE;
+        const char *end = data + block.size;
+        const char *nl;
+        while ((nl = memchr(data, '\n', end - data)))
+        {
+            // Lines started in an earlier block are completed in the carry buffer
+            if (pipeline->carryLength)
+            {
+                if (appendCarry(pipeline, data, nl - data))
+                {
+                    emitEnd(pipeline, PIPE_NO_MEMORY);
+                    return NULL;
+                }
+                if (emitLine(pipeline, pipeline->carry, pipeline->carryLength))
+                {
+                    return NULL;
+                }
+                pipeline->carryLength = 0;
+            }
+            else if (emitLine(pipeline, data, nl - data))
+            {
+                return NULL;
+            }
+
+            data = nl + 1;
+        }
+
+        if (appendCarry(pipeline, data, end - data))
+        {
+            emitEnd(pipeline, PIPE_NO_MEMORY);
+            return NULL;
+        }
+
+        if (waitPush(pipeline, &pipeline->empty, &block.index))
+        {
+            return NULL;
+        }
+    }
+}
+
+
+int runPipeline(int fd)
+{
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(Pipeline));
+    pipeline.fd = fd;
+    atomic_init(&pipeline.stop, 0);
+    atomic_init(&pipeline.sleeping, 0);
+    programInit(&pipeline.names);
+
+    pipeline.blocks = malloc((size_t) BLOCK_COUNT * BLOCK_SIZE);
+    int setup = !pipeline.blocks;
+    setup = setup || ringInit(&pipeline.empty, BLOCK_COUNT, sizeof(int));
+    setup = setup || ringInit(&pipeline.full, BLOCK_COUNT, sizeof(Block));
+    setup = setup || ringInit(&pipeline.decoded, DECODED_COUNT, sizeof(Decoded));
+    if (setup)
+    {
+        free(pipeline.blocks);
+        ringFree(&pipeline.empty);
+        ringFree(&pipeline.full);
+        fprintf(errStream(), "Error: not enough memory to read the program\n");
+        return 1;
+    }
+
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.moved, NULL);
+
+    // All blocks start out empty; the threads are not running yet, so this thread may produce
+    for (int i = 0; i < BLOCK_COUNT; i++)
+    {
+        ringPush(&pipeline.empty, &i);
+    }
+
+    pthread_t reader;
+    pthread_t decoder;
+    int started = 0;
+    if (!pthread_create(&reader, NULL, readBlocks, &pipeline))
+    {
+        started++;
+        if (!pthread_create(&decoder, NULL, decodeBlocks, &pipeline))
+        {
+            started++;
+        }
+    }
+
+    // Executor stage
+    int error = started < 2;
+    if (error)
+    {
+        fprintf(errStream(), "Error: starting the pipeline failed\n");
+    }
+
+    Decoded decoded;
+    while (!error && !waitPop(&pipeline, &pipeline.decoded, &decoded))
+    {
+        if (decoded.instruction.op == PIPE_END)
+        {
+            break;
+        }
+        if (decoded.instruction.op == PIPE_NO_MEMORY)
+        {
+            fprintf(errStream(), "Error: not enough memory to read the program\n");
+            error = 1;
+            break;
+        }
+        if (decoded.instruction.op == PIPE_READ_ERROR)
+        {
+            fprintf(errStream(), "Error: reading the program failed\n");
+            error = 1;
+            break;
+        }
+
+        int failed = executeDecoded(&decoded.instruction, decoded.name1, decoded.name2, decoded.operands,
+                                    decoded.text);
+        free(decoded.text);
+        if (failed)
+        {
+            error = 2;
+        }
+    }
+
+    // Stop the other stages; the reader may be blocked in read() on a pipe or terminal
+    atomic_store(&pipeline.stop, 1);
+    pthread_mutex_lock(&pipeline.lock);
+    pthread_cond_broadcast(&pipeline.moved);
+    pthread_mutex_unlock(&pipeline.lock);
+    if (started > 0)
+    {
+        pthread_cancel(reader);
+        pthread_join(reader, NULL);
+    }
+    if (started > 1)
+    {
+        pthread_join(decoder, NULL);
+    }
+
+    // Lines decoded beyond the point where execution stopped
+    while (!ringPop(&pipeline.decoded, &decoded))
+    {
+        free(decoded.text);
+    }
+
+    programFree(&pipeline.names);
+    free(pipeline.carry);
+    free(pipeline.blocks);
+    ringFree(&pipeline.empty);
+    ringFree(&pipeline.full);
+    ringFree(&pipeline.decoded);
+    pthread_mutex_destroy(&pipeline.lock);
+    pthread_cond_destroy(&pipeline.moved);
+
+    return error;
+}
@@ -0,0 +1,14 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* EFFECT: Reads, decodes, and executes the program from _fd_ on three threads: a reader thread fills 
+large blocks from _fd_, a decoder thread splits them into lines and decodes them, and the calling thread 
+executes the decoded lines as they arrive. The stages are connected by lock-free single-producer 
+single-consumer rings (see ring.h), so reading, decoding, and executing overlap; a stage that finds 
+its ring full or empty for long sleeps until the other end moves. Lines are executed in 
+order and execution stops at the first line that fails, exactly as when interpreting line by line
+OUTPUT: 0 upon successful execution of the function; 1 if reading or allocating memory failed; 
+2 if interpreting and executing a line failed */
+int runPipeline(int fd);
+
+#endif
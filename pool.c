@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "pool.h"
+
+/* A queued task */
+typedef struct Task
+{
+    PoolFunction run;
+    void *context;
+    int item;
+} Task;
+
+/* A worker thread and its deque, a ring of _capacity_ tasks that grows when full */
+typedef struct Worker
+{
+    pthread_t thread;
+    Pool *pool;
+    int index;
+    pthread_mutex_t lock;
+    Task *tasks;
+    int capacity;
+    int head;           // oldest task, the one stolen first
+    int count;
+} Worker;
+
+struct Pool
+{
+    Worker *workers;
+    int size;
+    atomic_int queued;      // tasks waiting in the deques
+    atomic_int pending;     // tasks submitted and not yet finished
+    atomic_int sleeping;    // workers waiting for _work_
+    atomic_uint next;       // deque of the next task submitted from outside the pool
+    int stop;
+    pthread_mutex_t lock;   // protects _stop_ and the waits on the conditions
+    pthread_cond_t work;    // signalled when a task is queued or the pool stops
+    pthread_cond_t idle;    // signalled when _pending_ drops to 0
+};
+
+// Pool and index of the worker running on this thread, if any
+static _Thread_local Pool *currentPool = NULL;
+static _Thread_local int currentWorker = -1;
+
+// Local functions
+int pushTask(Worker *worker, const Task *task);
+int popTask(Worker *worker, Task *task, int oldest);
+int takeTask(Pool *pool, int index, Task *task);
+void finishTask(Pool *pool);
+void *work(void *argument);
+
+int pushTask(Worker *worker, const Task *task)
+{
+    /* Local function
+    EFFECT: Appends _task_ to the deque of _worker_, growing it if needed
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+
+    pthread_mutex_lock(&worker->lock);
+
+    if (worker->count == worker->capacity)
+    {
+        int capacity = worker->capacity ? worker->capacity * 2 : 64;
+        Task *tasks = malloc(capacity * sizeof(Task));
+        if (!tasks)
+        {
+            pthread_mutex_unlock(&worker->lock);
+            return 1;
+        }
+
+        for (int i = 0; i < worker->count; i++)
+        {
+            tasks[i] = worker->tasks[(worker->head + i) % worker->capacity];
+        }
+
+        free(worker->tasks);
+        worker->tasks = tasks;
+        worker->capacity = capacity;
+        worker->head = 0;
+    }
+
+    worker->tasks[(worker->head + worker->count) % worker->capacity] = *task;
+    worker->count++;
+
+    pthread_mutex_unlock(&worker->lock);
+
+    return 0;
+}
+
+
+int popTask(Worker *worker, Task *task, int oldest)
+{
+    /* Local function
+    EFFECT: Removes the newest task of the deque of _worker_, or its oldest if _oldest_ is set, and
+    stores it in _task_
+    OUTPUT: 0 upon successful execution of the function; 1 if the deque is empty */
+
+    pthread_mutex_lock(&worker->lock);
+
+    if (!worker->count)
+    {
+        pthread_mutex_unlock(&worker->lock);
+        return 1;
+    }
+
+    if (oldest)
+    {
+        *task = worker->tasks[worker->head];
+        worker->head = (worker->head + 1) % worker->capacity;
+    }
+    else
+    {
+        *task = worker->tasks[(worker->head + worker->count - 1) % worker->capacity];
+    }
+    worker->count--;
+
+    pthread_mutex_unlock(&worker->lock);
+
+    return 0;
+}
+
+
+int takeTask(Pool *pool, int index, Task *task)
+{
+    /* Local function
+    EFFECT: Takes the newest task of worker _index_, or steals the oldest task of the next worker that
+    has any
+    OUTPUT: 0 upon successful execution of the function; 1 if all deques are empty */
+
+    if (!atomic_load(&pool->queued))
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < pool->size; i++)
+    {
+        if (!popTask(&pool->workers[(index + i) % pool->size], task, i != 0))
+        {
+            atomic_fetch_sub(&pool->queued, 1);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+void finishTask(Pool *pool)
+{
+    /* Local function
+    EFFECT: Accounts a finished task and wakes poolWait() when it was the last one */
+
+    if (atomic_fetch_sub(&pool->pending, 1) == 1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->idle);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+void *work(void *argument)
+{
+    /* Local function
+    EFFECT: Runs tasks of the pool of the worker _argument_ until the pool stops */
+
+    Worker *worker = argument;
+    Pool *pool = worker->pool;
+    Task task;
+
+    currentPool = pool;
+    currentWorker = worker->index;
+
+    for (;;)
+    {
+        if (!takeTask(pool, worker->index, &task))
+        {
+            task.run(task.context, task.item);
+            finishTask(pool);
+            continue;
+        }
+
+        // Announce the wait before checking for work, so that poolSubmit() either sees a sleeper or
+        // the check sees its task
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (!atomic_load(&pool->queued) && !pool->stop)
+        {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        int stop = pool->stop && !atomic_load(&pool->queued);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (stop)
+        {
+            return NULL;
+        }
+    }
+}
+
+
+Pool *poolCreate(int threads)
+{
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    Pool *pool = calloc(1, sizeof(Pool));
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    pool->workers = calloc(threads, sizeof(Worker));
+    if (!pool->workers)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->next, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pthread_mutex_init(&pool->workers[i].lock, NULL);
+    }
+
+    // Deques are complete before any worker steals from them
+    pool->size = threads;
+    for (int i = 0; i < threads; i++)
+    {
+        if (pthread_create(&pool->workers[i].thread, NULL, work, &pool->workers[i]))
+        {
+            pool->size = i;
+            poolDestroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+
+void poolDestroy(Pool *pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    poolWait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->size; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    for (int i = 0; pool->workers && i < pool->size; i++)
+    {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        free(pool->workers[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->workers);
+    free(pool);
+}
+
+
+void poolSubmit(Pool *pool, PoolFunction run, void *context, int item)
+{
+    Task task = { run, context, item };
+    int index = currentPool == pool ? currentWorker : (int) (atomic_fetch_add(&pool->next, 1) % pool->size);
+
+    atomic_fetch_add(&pool->pending, 1);
+    if (pushTask(&pool->workers[index], &task))
+    {
+        run(context, item);
+        finishTask(pool);
+        return;
+    }
+
+    atomic_fetch_add(&pool->queued, 1);
+    if (atomic_load(&pool->sleeping))
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+void poolWait(Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending))
+    {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+int poolSize(const Pool *pool)
+{
+    return pool->size;
+}
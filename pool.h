@@ -0,0 +1,30 @@
+#ifndef POOL_H
+#define POOL_H
+
+/* Persistent pool of worker threads with work stealing. Every worker owns a deque of tasks: it runs the
+task it pushed last first, and when its own deque is empty it steals the oldest task of another worker.
+Tasks may submit further tasks, e.g. the ones that only become ready once they finished */
+typedef struct Pool Pool;
+
+/* A task calls _run_(_context_, _item_) */
+typedef void (*PoolFunction)(void *context, int item);
+
+/* EFFECT: Starts a pool of _threads_ worker threads
+OUTPUT: The pool; NULL if allocating memory or starting a thread failed */
+Pool *poolCreate(int threads);
+
+/* EFFECT: Waits for all tasks of _pool_ to finish, stops its threads, and frees it */
+void poolDestroy(Pool *pool);
+
+/* EFFECT: Queues the task _run_(_context_, _item_) on _pool_: on the deque of the calling worker when
+called by a task, and on the deques of the workers in turn otherwise. If queueing fails for lack of
+memory, the task runs right away in the calling thread, so submitting never fails */
+void poolSubmit(Pool *pool, PoolFunction run, void *context, int item);
+
+/* EFFECT: Waits until all tasks submitted to _pool_ finished, including those they submitted */
+void poolWait(Pool *pool);
+
+/* OUTPUT: The number of worker threads of _pool_ */
+int poolSize(const Pool *pool);
+
+#endif
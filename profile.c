@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+#include "program.h"
+
+// Number of source lines in the report
+#define REPORT_LINES 20
+
+static const char *opNames[OP_COUNT] = { "Ass", "Inc", "Dec", "Mal", "Pri", "Add", "Sub", "Mul", "And", "Xor",
+                                         "Fre", "Pra", "Mal bit", "Cnt", "Srt", "Scn", "Scx", "Fil", "Cpy", "Rea",
+                                         "(raw)" };
+
+/* A row of the report: an operator or a source line */
+typedef struct Row
+{
+    int key;            // operator, or index of the first instruction of the line
+    int line;
+    uint64_t count;
+    uint64_t ns;
+} Row;
+
+// Local functions
+int compareRows(const void *a, const void *b);
+double share(uint64_t part, uint64_t total);
+
+int compareRows(const void *a, const void *b)
+{
+    const Row *rowA = a;
+    const Row *rowB = b;
+
+    if (rowA->ns != rowB->ns)
+    {
+        return rowA->ns < rowB->ns ? 1 : -1;
+    }
+    return rowA->line - rowB->line;
+}
+
+
+double share(uint64_t part, uint64_t total)
+{
+    /* Local function
+    EFFECT: Computes _part_ as a percentage of _total_
+    OUTPUT: The percentage; 0 if _total_ is 0 */
+
+    return total ? 100.0 * part / total : 0;
+}
+
+
+int profileInit(Profile *profile, const Program *program)
+{
+    memset(profile, 0, sizeof(Profile));
+
+    size_t length = program->length ? program->length : 1;
+    profile->count = calloc(length, sizeof(uint64_t));
+    profile->ns = calloc(length, sizeof(uint64_t));
+    if (!profile->count || !profile->ns)
+    {
+        profileFree(profile);
+        return 1;
+    }
+    profile->length = program->length;
+
+    return 0;
+}
+
+
+void profileFree(Profile *profile)
+{
+    free(profile->count);
+    free(profile->ns);
+    profile->count = NULL;
+    profile->ns = NULL;
+}
+
+
+uint64_t profileClock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+
+void profileReport(const Profile *profile, const Program *program, FILE *stream)
+{
+    uint64_t executed = 0;
+    for (int op = 0; op < OP_COUNT; op++)
+    {
+        executed += profile->opCount[op];
+    }
+
+    fprintf(stream, "Profile: %llu instructions in %.3f ms; %.3f ms (%.1f%%) in %llu checked memory calls\n",
+            (unsigned long long) executed, profile->totalNs / 1e6, profile->memory.ns / 1e6,
+            share(profile->memory.ns, profile->totalNs), (unsigned long long) profile->memory.calls);
+
+    Row rows[OP_COUNT];
+    int count = 0;
+    for (int op = 0; op < OP_COUNT; op++)
+    {
+        if (profile->opCount[op])
+        {
+            Row row = { op, op, profile->opCount[op], profile->opNs[op] };
+            rows[count++] = row;
+        }
+    }
+    qsort(rows, count, sizeof(Row), compareRows);
+
+    fprintf(stream, "%-10s %12s %12s %10s %7s\n", "operator", "count", "total ms", "avg ns", "time");
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(stream, "%-10s %12llu %12.3f %10.1f %6.1f%%\n", opNames[rows[i].key], (unsigned long long) rows[i].count,
+                rows[i].ns / 1e6, (double) rows[i].ns / rows[i].count, share(rows[i].ns, profile->totalNs));
+    }
+
+    // Every line holds at most one instruction, so the instructions are the lines
+    Row *lines = malloc((profile->length ? profile->length : 1) * sizeof(Row));
+    if (!lines)
+    {
+        return;
+    }
+
+    count = 0;
+    for (int i = 0; i < profile->length; i++)
+    {
+        if (profile->count[i])
+        {
+            Row row = { i, program->code[i].line, profile->count[i], profile->ns[i] };
+            lines[count++] = row;
+        }
+    }
+    qsort(lines, count, sizeof(Row), compareRows);
+
+    fprintf(stream, "%-10s %12s %12s %10s %7s  %s\n", "line", "count", "total ms", "avg ns", "time", "operator");
+    for (int i = 0; i < count && i < REPORT_LINES; i++)
+    {
+        fprintf(stream, "%-10d %12llu %12.3f %10.1f %6.1f%%  %s\n", lines[i].line, (unsigned long long) lines[i].count,
+                lines[i].ns / 1e6, (double) lines[i].ns / lines[i].count, share(lines[i].ns, profile->totalNs),
+                opNames[program->code[lines[i].key].op]);
+    }
+    free(lines);
+}
@@ -0,0 +1,36 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "memory.h"
+#include "program.h"
+
+/* Execution profile of a program, filled by executeProgramProfiled() */
+typedef struct Profile
+{
+    uint64_t opCount[OP_COUNT];     // executions per operator
+    uint64_t opNs[OP_COUNT];        // nanoseconds per operator
+    uint64_t *count;                // executions per instruction of the program
+    uint64_t *ns;                   // nanoseconds per instruction of the program
+    int length;
+    uint64_t totalNs;
+    MemProfile memory;              // checked memory accesses (see memory.h)
+} Profile;
+
+/* EFFECT: Initializes _profile_ for the instructions of _program_, all counts being 0
+OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+int profileInit(Profile *profile, const Program *program);
+
+/* EFFECT: Frees all memory allocated for _profile_ */
+void profileFree(Profile *profile);
+
+/* EFFECT: Reads the monotonic clock
+OUTPUT: The time in nanoseconds */
+uint64_t profileClock(void);
+
+/* EFFECT: Writes a report of _profile_ of _program_ to _stream_: the total time, the time inside memory.c, 
+the operators sorted by time, and the source lines taking most time */
+void profileReport(const Profile *profile, const Program *program, FILE *stream);
+
+#endif
@@ -0,0 +1,857 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include "functions.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "memory.h"
+#include "output.h"
+#include "pool.h"
+#include "profile.h"
+#include "program.h"
+
+// Most consecutive independent instructions scheduled at once by executeProgramParallel()
+#define WINDOW_SIZE 1024
+
+/* An instruction of a window of executeProgramParallel() with the cells it operates on, so that any 
+thread can execute it */
+typedef struct Node
+{
+    const Instruction *instruction;
+    int *cells1;
+    const int *cells2;
+    int length;             // of the first array
+    int next[2];            // next instruction of the window using the first and the second array; -1 if none
+    atomic_int waiting;     // instructions of the window this one still has to wait for
+} Node;
+
+/* Dependency graph of a window of instructions */
+typedef struct Window
+{
+    Pool *pool;
+    Node nodes[WINDOW_SIZE];
+    int roots[WINDOW_SIZE]; // instructions that do not wait for any other
+} Window;
+
+// Local functions
+unsigned int hashName(const char *name, size_t length);
+int growBuckets(Program *program);
+int appendInstruction(Program *program, const Instruction *instruction);
+int appendText(Program *program, const char *text, size_t length);
+int appendOperands(Program *program, const int32_t *operands);
+int executeInstruction(const Program *program, const Instruction *instruction, Array **handles, int checked);
+int releaseArrays(const Program *program, const Instruction *instruction, Array **handles);
+int independent(const Instruction *instruction);
+int buildWindow(Window *window, const Program *program, int start, int end, Array **handles, int *last);
+void applyNode(const Node *node);
+void runNode(void *context, int item);
+
+unsigned int hashName(const char *name, size_t length)
+{
+    /* Local function
+    EFFECT: Computes the FNV-1a hash of the _length_ characters of _name_
+    OUTPUT: The hash of _name_ */
+
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+int growBuckets(Program *program)
+{
+    /* Local function
+    EFFECT: Doubles the number of buckets of the identifier index of _program_ and rehashes all identifiers
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+
+    int bucketCount = program->bucketCount ? program->bucketCount * 2 : 64;
+    int *buckets = malloc(bucketCount * sizeof(int));
+    if (!buckets)
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < bucketCount; i++)
+    {
+        buckets[i] = -1;
+    }
+
+    for (int slot = 0; slot < program->nameCount; slot++)
+    {
+        const char *name = program->names[slot];
+        unsigned int i = hashName(name, strlen(name)) & (bucketCount - 1);
+        while (buckets[i] >= 0)
+        {
+            i = (i + 1) & (bucketCount - 1);
+        }
+        buckets[i] = slot;
+    }
+
+    free(program->buckets);
+    program->buckets = buckets;
+    program->bucketCount = bucketCount;
+
+    return 0;
+}
+
+
+int appendInstruction(Program *program, const Instruction *instruction)
+{
+    /* Local function
+    EFFECT: Appends _instruction_ to the code of _program_
+    OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+
+    if (program->length == program->capacity)
+    {
+        int capacity = program->capacity ? program->capacity * 2 : 256;
+        Instruction *code = realloc(program->code, capacity * sizeof(Instruction));
+        if (!code)
+        {
+            return 1;
+        }
+
+        program->code = code;
+        program->capacity = capacity;
+    }
+
+    program->code[program->length++] = *instruction;
+
+    return 0;
+}
+
+
+int appendText(Program *program, const char *text, size_t length)
+{
+    /* Local function
+    EFFECT: Appends a NUL-terminated copy of the _length_ characters of _text_ to the text table of _program_
+    OUTPUT: The index of the copy in the text table; -1 if allocating memory failed */
+
+    if (program->textCount == program->textCapacity)
+    {
+        int capacity = program->textCapacity ? program->textCapacity * 2 : 8;
+        char **texts = realloc(program->texts, capacity * sizeof(char *));
+        if (!texts)
+        {
+            return -1;
+        }
+
+        program->texts = texts;
+        program->textCapacity = capacity;
+    }
+
+    char *copy = strndup(text, length);
+    if (!copy)
+    {
+        return -1;
+    }
+
+    program->texts[program->textCount] = copy;
+    return program->textCount++;
+}
+
+
+int appendOperands(Program *program, const int32_t *operands)
+{
+    /* Local function
+    EFFECT: Appends the three numbers at _operands_ to the operand table of _program_
+    OUTPUT: The index of the first of them in the operand table; -1 if allocating memory failed */
+
+    if (program->operandCount + 3 > program->operandCapacity)
+    {
+        int capacity = program->operandCapacity ? program->operandCapacity * 2 : 48;
+        int32_t *table = realloc(program->operands, capacity * sizeof(int32_t));
+        if (!table)
+        {
+            return -1;
+        }
+
+        program->operands = table;
+        program->operandCapacity = capacity;
+    }
+
+    memcpy(program->operands + program->operandCount, operands, 3 * sizeof(int32_t));
+    program->operandCount += 3;
+
+    return program->operandCount - 3;
+}
+
+
+int executeInstruction(const Program *program, const Instruction *instruction, Array **handles, int checked)
+{
+    /* Local function
+    EFFECT: Executes _instruction_ of _program_. _handles_ caches the handle of every live array by slot
+    and is updated on allocation and freeing. Unless _checked_ is set, instructions flagged INS_UNCHECKED 
+    run on the unchecked fast path
+    OUTPUT: 0 upon successful execution of the function; 1 if executing the instruction failed */
+
+    int slot1 = instruction->slot1;
+    int slot2 = instruction->slot2;
+
+    if ((instruction->flags & INS_UNCHECKED) && !checked)
+    {
+        switch (instruction->op)
+        {
+            case OP_ASS: assignUnchecked(handles[slot1], instruction->value); return 0;
+            case OP_INC: increaseUnchecked(handles[slot1], instruction->value); return 0;
+            case OP_DEC: decreaseUnchecked(handles[slot1], instruction->value); return 0;
+            case OP_PRI: printCellUnchecked(handles[slot1], instruction->value); return 0;
+            case OP_ADD: dualArrayOperatorUnchecked(handles[slot1], handles[slot2], '+', 1); return 0;
+            case OP_SUB: dualArrayOperatorUnchecked(handles[slot1], handles[slot2], '-', 1); return 0;
+            case OP_MUL: dualArrayOperatorUnchecked(handles[slot1], handles[slot2], '*', 1); return 0;
+            case OP_AND: dualArrayOperatorUnchecked(handles[slot1], handles[slot2], '&', 0); return 0;
+            case OP_XOR: dualArrayOperatorUnchecked(handles[slot1], handles[slot2], '^', 0); return 0;
+            case OP_PRA: printArrayUnchecked(handles[slot1]); return 0;
+        }
+    }
+
+    const char *name1 = slot1 >= 0 ? program->names[slot1] : NULL;
+    const char *name2 = slot2 >= 0 ? program->names[slot2] : NULL;
+    const char *text = instruction->op == OP_RAW ? program->texts[instruction->value] : NULL;
+    const int32_t *operands = instruction->op == OP_FIL || instruction->op == OP_CPY 
+                              ? program->operands + instruction->value : NULL;
+
+    if (executeDecoded(instruction, name1, name2, operands, text))
+    {
+        return 1;
+    }
+
+    if (instruction->op == OP_MAL || instruction->op == OP_BIT)
+    {
+        handles[slot1] = findArray(name1);
+    }
+    else if (instruction->op == OP_FRE)
+    {
+        handles[slot1] = NULL;
+    }
+
+    return 0;
+}
+
+
+int releaseArrays(const Program *program, const Instruction *instruction, Array **handles)
+{
+    /* Local function
+    EFFECT: Frees the arrays of _instruction_ that the liveness analysis found to be dead after it
+    OUTPUT: 0 upon successful execution of the function; 1 if freeing an array failed */
+
+    if (instruction->flags & INS_FREE1)
+    {
+        if (freeArray(program->names[instruction->slot1]))
+        {
+            return 1;
+        }
+        handles[instruction->slot1] = NULL;
+    }
+
+    if (instruction->flags & INS_FREE2)
+    {
+        if (freeArray(program->names[instruction->slot2]))
+        {
+            return 1;
+        }
+        handles[instruction->slot2] = NULL;
+    }
+
+    return 0;
+}
+
+
+int independent(const Instruction *instruction)
+{
+    /* Local function
+    EFFECT: Checks whether _instruction_ only depends on the instructions using the same arrays: it is 
+    proven safe, so it can not fail, and it neither prints nor allocates or frees arrays
+    OUTPUT: 1 if _instruction_ may run in parallel with instructions using other arrays; 0 otherwise */
+
+    if ((instruction->flags & (INS_UNCHECKED | INS_FREE1 | INS_FREE2)) != INS_UNCHECKED)
+    {
+        return 0;
+    }
+
+    switch (instruction->op)
+    {
+        case OP_ASS: case OP_INC: case OP_DEC: case OP_ADD: case OP_SUB: case OP_MUL: case OP_AND: case OP_XOR:
+            return 1;
+    }
+
+    return 0;
+}
+
+
+int buildWindow(Window *window, const Program *program, int start, int end, Array **handles, int *last)
+{
+    /* Local function
+    EFFECT: Builds the dependency graph of the independent instructions [_start_, _end_) of _program_ in 
+    _window_: every instruction waits for the previous instruction using any of its arrays. _last_ holds 
+    -1 for every slot and is restored before returning
+    OUTPUT: The number of instructions that do not wait for any other, listed in the roots of _window_ */
+
+    int roots = 0;
+
+    for (int k = 0; k < end - start; k++)
+    {
+        const Instruction *instruction = &program->code[start + k];
+        Node *node = &window->nodes[k];
+        int slots[2] = { instruction->slot1, instruction->slot2 != instruction->slot1 ? instruction->slot2 : -1 };
+        int waiting = 0;
+
+        node->instruction = instruction;
+        node->cells1 = arrayCells(handles[slots[0]]);
+        node->cells2 = instruction->slot2 >= 0 ? arrayCells(handles[instruction->slot2]) : NULL;
+        node->length = arrayLength(handles[slots[0]]);
+        node->next[0] = node->next[1] = -1;
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (slots[i] < 0)
+            {
+                continue;
+            }
+
+            int previous = last[slots[i]];
+            if (previous >= 0)
+            {
+                // Link from the entry of _previous_ for this array
+                Node *before = &window->nodes[previous];
+                before->next[before->instruction->slot1 == slots[i] ? 0 : 1] = k;
+                waiting++;
+            }
+            last[slots[i]] = k;
+        }
+
+        atomic_init(&node->waiting, waiting);
+        if (!waiting)
+        {
+            window->roots[roots++] = k;
+        }
+    }
+
+    for (int k = 0; k < end - start; k++)
+    {
+        last[program->code[start + k].slot1] = -1;
+        if (program->code[start + k].slot2 >= 0)
+        {
+            last[program->code[start + k].slot2] = -1;
+        }
+    }
+
+    return roots;
+}
+
+
+void applyNode(const Node *node)
+{
+    /* Local function
+    EFFECT: Executes the instruction of _node_ on its cells, like the unchecked functions of functions.h */
+
+    int value = node->instruction->value;
+    int *cells1 = node->cells1;
+    const int *cells2 = node->cells2;
+
+    switch (node->instruction->op)
+    {
+        case OP_ASS: cells1[0] = value; break;
+        case OP_INC: cells1[value] += 1; break;
+        case OP_DEC: cells1[value] -= 1; break;
+        case OP_ADD: cells1[0] = cells1[0] + cells2[0]; break;
+        case OP_SUB: cells1[0] = cells1[0] - cells2[0]; break;
+        case OP_MUL: cells1[0] = cells1[0] * cells2[0]; break;
+        case OP_AND:
+            for (int i = 0; i < node->length; i++)
+            {
+                cells1[i] = (cells1[i] * cells2[i]) % 2;
+            }
+            break;
+        case OP_XOR:
+            for (int i = 0; i < node->length; i++)
+            {
+                cells1[i] = (cells1[i] + cells2[i]) % 2;
+            }
+            break;
+    }
+}
+
+
+void runNode(void *context, int item)
+{
+    /* Local function
+    EFFECT: Pool task executing instruction _item_ of the window _context_ and then those that no longer 
+    wait for any other; the first of them in the same task, so that chains do not go through the pool */
+
+    Window *window = context;
+
+    while (item >= 0)
+    {
+        const Node *node = &window->nodes[item];
+        applyNode(node);
+
+        item = -1;
+        for (int i = 0; i < 2; i++)
+        {
+            int next = node->next[i];
+            if (next >= 0 && atomic_fetch_sub(&window->nodes[next].waiting, 1) == 1)
+            {
+                if (item < 0)
+                {
+                    item = next;
+                }
+                else
+                {
+                    poolSubmit(window->pool, runNode, window, next);
+                }
+            }
+        }
+    }
+}
+
+
+int executeDecoded(const Instruction *instruction, const char *name1, const char *name2, 
+                   const int32_t *operands, const char *text)
+{
+    switch (instruction->op)
+    {
+        case OP_ASS: return assign(name1, instruction->value) != 0;
+        case OP_INC: return increase(name1, instruction->value) != 0;
+        case OP_DEC: return decrease(name1, instruction->value) != 0;
+        case OP_MAL: return allocate(name1, instruction->value) != 0;
+        case OP_PRI: return printCell(name1, instruction->value) != 0;
+        case OP_ADD: return add(name1, name2) != 0;
+        case OP_SUB: return subtract(name1, name2) != 0;
+        case OP_MUL: return multiply(name1, name2) != 0;
+        case OP_AND: return andArrays(name1, name2) != 0;
+        case OP_XOR: return xorArrays(name1, name2) != 0;
+        case OP_FRE: return freeArray(name1) != 0;
+        case OP_PRA: return printArray(name1) != 0;
+        case OP_BIT: return allocateBits(name1, instruction->value) != 0;
+        case OP_CNT: return countArray(name1) != 0;
+        case OP_SRT: return sortArray(name1) != 0;
+        case OP_SCN: return scanArray(name1, 0) != 0;
+        case OP_SCX: return scanArray(name1, 1) != 0;
+        case OP_FIL:
+            return (operands[2] < 0 ? fillArray(name1, operands[0])
+                                    : fillRange(name1, operands[0], operands[1], operands[2])) != 0;
+        case OP_CPY:
+            return (operands[2] < 0 ? copyArray(name1, name2)
+                                    : copyRange(name1, name2, operands[0], operands[1], operands[2])) != 0;
+        case OP_REA: return reallocate(name1, instruction->value) != 0;
+    }
+
+    // OP_RAW: let the interpreter report the error on a copy, so _text_ stays unchanged. The line
+    // does not parse, so it fails however the interpreter fares with it, which the analysis relies on
+    char *line = strdup(text);
+    if (!line)
+    {
+        fprintf(errStream(), "Error: not enough memory to execute line %d\n", instruction->line);
+        return 1;
+    }
+
+    interpretLine(line);
+    free(line);
+
+    return 1;
+}
+
+
+void programInit(Program *program)
+{
+    memset(program, 0, sizeof(Program));
+}
+
+
+void programFree(Program *program)
+{
+    // The code and strings of a precompiled program live in its mapping
+    if (program->mapping)
+    {
+        free(program->names);
+        free(program->texts);
+        jitFree(program->jit);
+        munmap(program->mapping, program->mappingSize);
+        programInit(program);
+        return;
+    }
+
+    for (int i = 0; i < program->nameCount; i++)
+    {
+        free(program->names[i]);
+    }
+
+    for (int i = 0; i < program->textCount; i++)
+    {
+        free(program->texts[i]);
+    }
+
+    free(program->code);
+    free(program->names);
+    free(program->buckets);
+    free(program->operands);
+    free(program->texts);
+    jitFree(program->jit);
+
+    programInit(program);
+}
+
+
+int programIntern(Program *program, const char *name, size_t length)
+{
+    // Keep the load factor of the index below one half
+    if (2 * (program->nameCount + 1) > program->bucketCount && growBuckets(program))
+    {
+        return -1;
+    }
+
+    unsigned int mask = program->bucketCount - 1;
+    unsigned int i = hashName(name, length) & mask;
+    while (program->buckets[i] >= 0)
+    {
+        const char *known = program->names[program->buckets[i]];
+        if (!strncmp(known, name, length) && known[length] == '\0')
+        {
+            return program->buckets[i];
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (program->nameCount == program->nameCapacity)
+    {
+        int capacity = program->nameCapacity ? program->nameCapacity * 2 : 16;
+        char **names = realloc(program->names, capacity * sizeof(char *));
+        if (!names)
+        {
+            return -1;
+        }
+
+        program->names = names;
+        program->nameCapacity = capacity;
+    }
+
+    char *copy = strndup(name, length);
+    if (!copy)
+    {
+        return -1;
+    }
+
+    program->names[program->nameCount] = copy;
+    program->buckets[i] = program->nameCount;
+
+    return program->nameCount++;
+}
+
+
+int programAddLine(Program *program, const char *line, size_t length, int lineNumber)
+{
+    Instruction instruction = { OP_RAW, 0, -1, -1, 0, lineNumber };
+    Token name1;
+    Token name2;
+    int32_t operands[3];
+
+    int status = decodeLine(line, length, &instruction, &name1, &name2, operands);
+    if (status == 1)
+    {
+        return 0;
+    }
+
+    if (status == 2)
+    {
+        instruction.op = OP_RAW;
+        instruction.value = appendText(program, line, length);
+        if (instruction.value < 0)
+        {
+            return 1;
+        }
+
+        return appendInstruction(program, &instruction);
+    }
+
+    if (status)
+    {
+        return 1;
+    }
+
+    instruction.slot1 = programIntern(program, name1.text, name1.length);
+    instruction.slot2 = name2.text ? programIntern(program, name2.text, name2.length) : -1;
+    if (instruction.slot1 < 0 || (name2.text && instruction.slot2 < 0))
+    {
+        return 1;
+    }
+
+    if (instruction.op == OP_FIL || instruction.op == OP_CPY)
+    {
+        instruction.value = appendOperands(program, operands);
+        if (instruction.value < 0)
+        {
+            return 1;
+        }
+    }
+
+    return appendInstruction(program, &instruction);
+}
+
+
+int programMerge(Program *program, Program *part, int lineOffset)
+{
+    int *slots = malloc((part->nameCount ? part->nameCount : 1) * sizeof(int));
+    if (!slots)
+    {
+        return 1;
+    }
+
+    for (int slot = 0; slot < part->nameCount; slot++)
+    {
+        const char *name = part->names[slot];
+        slots[slot] = programIntern(program, name, strlen(name));
+        if (slots[slot] < 0)
+        {
+            free(slots);
+            return 1;
+        }
+    }
+
+    // Make room for everything first, so that nothing fails once _part_ is being taken apart
+    if (program->length + part->length > program->capacity)
+    {
+        int capacity = program->length + part->length;
+        Instruction *code = realloc(program->code, capacity * sizeof(Instruction));
+        if (!code)
+        {
+            free(slots);
+            return 1;
+        }
+        program->code = code;
+        program->capacity = capacity;
+    }
+
+    if (program->textCount + part->textCount > program->textCapacity)
+    {
+        int capacity = program->textCount + part->textCount;
+        char **texts = realloc(program->texts, capacity * sizeof(char *));
+        if (!texts)
+        {
+            free(slots);
+            return 1;
+        }
+        program->texts = texts;
+        program->textCapacity = capacity;
+    }
+
+    if (program->operandCount + part->operandCount > program->operandCapacity)
+    {
+        int capacity = program->operandCount + part->operandCount;
+        int32_t *operands = realloc(program->operands, capacity * sizeof(int32_t));
+        if (!operands)
+        {
+            free(slots);
+            return 1;
+        }
+        program->operands = operands;
+        program->operandCapacity = capacity;
+    }
+
+    int operandBase = program->operandCount;
+    if (part->operandCount)
+    {
+        memcpy(program->operands + operandBase, part->operands, part->operandCount * sizeof(int32_t));
+        program->operandCount += part->operandCount;
+    }
+
+    // The source lines of OP_RAW instructions change owner without copying
+    int textBase = program->textCount;
+    memcpy(program->texts + textBase, part->texts, part->textCount * sizeof(char *));
+    program->textCount += part->textCount;
+    part->textCount = 0;
+
+    for (int i = 0; i < part->length; i++)
+    {
+        Instruction instruction = part->code[i];
+        if (instruction.op == OP_RAW)
+        {
+            instruction.value += textBase;
+        }
+        else
+        {
+            instruction.slot1 = slots[instruction.slot1];
+            instruction.slot2 = instruction.slot2 >= 0 ? slots[instruction.slot2] : -1;
+            if (instruction.op == OP_FIL || instruction.op == OP_CPY)
+            {
+                instruction.value += operandBase;
+            }
+        }
+        instruction.line += lineOffset;
+
+        program->code[program->length++] = instruction;
+    }
+
+    free(slots);
+    programFree(part);
+
+    return 0;
+}
+
+
+int executeProgram(Program *program)
+{
+    Array **handles = calloc(program->nameCount ? program->nameCount : 1, sizeof(Array *));
+    if (!handles)
+    {
+        fprintf(errStream(), "Error: not enough memory to execute program\n");
+        return 2;
+    }
+
+    // Native code addresses the cells directly, which a sparse memory does not have, and a sparse memory
+    // may run out of pages on any write, which only the checked path reports
+    int sparse = memSparse();
+    JitCode *jit = sparse ? NULL : program->jit;
+
+    int error = 0;
+    program->errorLine = 0;
+    for (int i = 0; i < program->length && !error; i++)
+    {
+        if (jit)
+        {
+            int executed = jitRun(jit, i, handles);
+            if (executed)
+            {
+                i += executed - 1;
+                continue;
+            }
+        }
+
+        const Instruction *instruction = &program->code[i];
+        error = executeInstruction(program, instruction, handles, sparse);
+        if (!error && (instruction->flags & (INS_FREE1 | INS_FREE2)))
+        {
+            error = releaseArrays(program, instruction, handles);
+        }
+        if (error)
+        {
+            program->errorLine = instruction->line;
+        }
+    }
+
+    free(handles);
+
+    return error;
+}
+
+
+int executeProgramParallel(Program *program, Pool *pool)
+{
+    // Windows work on the cells directly, which a sparse memory does not have
+    if (memSparse())
+    {
+        return executeProgram(program);
+    }
+
+    int slots = program->nameCount ? program->nameCount : 1;
+    Array **handles = calloc(slots, sizeof(Array *));
+    int *last = malloc(slots * sizeof(int));
+    Window *window = malloc(sizeof(Window));
+    if (!handles || !last || !window)
+    {
+        fprintf(errStream(), "Error: not enough memory to execute program\n");
+        free(handles);
+        free(last);
+        free(window);
+        return 2;
+    }
+
+    for (int i = 0; i < slots; i++)
+    {
+        last[i] = -1;
+    }
+    window->pool = pool;
+
+    int error = 0;
+    program->errorLine = 0;
+    for (int i = 0; i < program->length && !error; )
+    {
+        int end = i;
+        while (end < program->length && end - i < WINDOW_SIZE && independent(&program->code[end]))
+        {
+            end++;
+        }
+
+        // Only worth going through the pool if more than one instruction can start right away
+        int roots = end - i > 1 ? buildWindow(window, program, i, end, handles, last) : 0;
+        if (roots > 1)
+        {
+            for (int k = 0; k < roots; k++)
+            {
+                poolSubmit(pool, runNode, window, window->roots[k]);
+            }
+            poolWait(pool);
+            i = end;
+            continue;
+        }
+
+        // Barriers, and windows that are a single chain, run in order on this thread
+        for (end = end > i ? end : i + 1; i < end && !error; i++)
+        {
+            const Instruction *instruction = &program->code[i];
+            error = executeInstruction(program, instruction, handles, 0);
+            if (!error && (instruction->flags & (INS_FREE1 | INS_FREE2)))
+            {
+                error = releaseArrays(program, instruction, handles);
+            }
+            if (error)
+            {
+                program->errorLine = instruction->line;
+            }
+        }
+    }
+
+    free(window);
+    free(last);
+    free(handles);
+
+    return error;
+}
+
+
+int executeProgramProfiled(Program *program, Profile *profile)
+{
+    Array **handles = calloc(program->nameCount ? program->nameCount : 1, sizeof(Array *));
+    if (!handles)
+    {
+        fprintf(errStream(), "Error: not enough memory to execute program\n");
+        return 2;
+    }
+
+    int sparse = memSparse();
+    int error = 0;
+    program->errorLine = 0;
+    uint64_t begin = profileClock();
+    for (int i = 0; i < program->length && !error; i++)
+    {
+        const Instruction *instruction = &program->code[i];
+        uint64_t start = profileClock();
+
+        error = executeInstruction(program, instruction, handles, sparse);
+        if (!error && (instruction->flags & (INS_FREE1 | INS_FREE2)))
+        {
+            error = releaseArrays(program, instruction, handles);
+        }
+        if (error)
+        {
+            program->errorLine = instruction->line;
+        }
+
+        uint64_t elapsed = profileClock() - start;
+        profile->count[i]++;
+        profile->ns[i] += elapsed;
+        profile->opCount[instruction->op]++;
+        profile->opNs[instruction->op] += elapsed;
+    }
+    profile->totalNs += profileClock() - begin;
+
+    free(handles);
+
+    return error;
+}
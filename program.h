@@ -0,0 +1,150 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Operators of the mini-language in decoded form */
+typedef enum Opcode
+{
+    OP_ASS,
+    OP_INC,
+    OP_DEC,
+    OP_MAL,
+    OP_PRI,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_AND,
+    OP_XOR,
+    OP_FRE,
+    OP_PRA,
+    OP_BIT,     // Mal of an array of single bits
+    OP_CNT,
+    OP_SRT,
+    OP_SCN,     // inclusive prefix sum
+    OP_SCX,     // exclusive prefix sum
+    OP_FIL,
+    OP_CPY,
+    OP_REA,
+    OP_RAW      // line that does not parse; replayed through interpretLine() to report the error
+} Opcode;
+
+#define OP_COUNT (OP_RAW + 1)
+
+struct Profile;
+struct Pool;
+
+/* Flags of an instruction, set by the analysis passes */
+#define INS_UNCHECKED 0x1       // proven to access live arrays in bounds, runs on the unchecked fast path
+#define INS_FREE1 0x2           // last use of the first array, free it after executing
+#define INS_FREE2 0x4           // last use of the second array, free it after executing
+
+/* A decoded line of the program. Identifiers are stored as slots in the identifier table of the
+program, so that no string handling is needed while executing */
+typedef struct Instruction
+{
+    int32_t op;         // Opcode
+    int32_t flags;      // INS_* flags
+    int32_t slot1;      // slot of the first identifier; -1 if none
+    int32_t slot2;      // slot of the second identifier; -1 if none
+    int32_t value;      // number parameter; index in the text table for OP_RAW; index of the first
+                        // of three operands in the operand table for OP_FIL and OP_CPY
+    int32_t line;       // line number in the source
+} Instruction;
+
+/* A program decoded ahead of execution: the instructions in source order, the table of identifiers
+they refer to, the numbers of instructions taking more than one, and the source text of lines that 
+failed to parse */
+typedef struct Program
+{
+    Instruction *code;
+    int length;
+    int capacity;
+
+    char **names;       // identifier of each slot
+    int nameCount;
+    int nameCapacity;
+    int *buckets;       // open-addressing hash index over _names_, -1 marks an empty bucket
+    int bucketCount;
+
+    int32_t *operands;  // numbers of OP_FIL (value, start, length) and OP_CPY (start1, start2, length);
+                        // a length of -1 stands for the whole array
+    int operandCount;
+    int operandCapacity;
+
+    char **texts;       // source text of OP_RAW instructions
+    int textCount;
+    int textCapacity;
+
+    struct JitCode *jit; // native code for blocks of the program (see jit.h); NULL to interpret
+    int analysed;       // the flags of the analysis passes are set, e.g. for precompiled programs
+
+    void *mapping;      // precompiled program file that code and strings point into (see binary.h)
+    size_t mappingSize;
+
+    int errorLine;      // line of the instruction at which the last execution stopped; 0 if none
+} Program;
+
+/* EFFECT: Initializes _program_ as an empty program */
+void programInit(Program *program);
+
+/* EFFECT: Frees all memory allocated for _program_, including its native code, unmaps the precompiled 
+program file it was loaded from, if any, and leaves it empty */
+void programFree(Program *program);
+
+/* EFFECT: Decodes the _length_ characters at _line_ (without trailing newline, not necessarily 
+NUL-terminated) and appends them to _program_ as an instruction with line number _lineNumber_. Empty 
+lines are skipped. Lines that do not parse are kept as OP_RAW, so that the error is reported when, and 
+only if, execution reaches them. _line_ is only read, so it may point into a read-only mapping
+OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+int programAddLine(Program *program, const char *line, size_t length, int lineNumber);
+
+/* EFFECT: Returns the slot of the identifier made of the _length_ characters at _name_ in _program_, 
+adding it if it is not yet known
+OUTPUT: The slot of the identifier; -1 if allocating memory failed */
+int programIntern(Program *program, const char *name, size_t length);
+
+/* EFFECT: Appends the instructions of _part_, a program decoded separately from the lines following 
+those of _program_, to _program_ and frees _part_. The identifiers of _part_ are interned in _program_ 
+and its instructions are rewritten to the merged slots; _lineOffset_ is added to their line numbers
+OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+int programMerge(Program *program, Program *part, int lineOffset);
+
+/* EFFECT: Executes the single _instruction_ through the functions declared in functions.h, ignoring its 
+flags and slots. _name1_ and _name2_ are the identifiers of its slots, _operands_ are its three operands 
+if it is an OP_FIL or OP_CPY instruction, and _text_ is its source line if it is an OP_RAW instruction. 
+Used where no whole program is available, e.g. when pipelining
+OUTPUT: 0 upon successful execution of the function; 1 if the instruction failed, which OP_RAW 
+instructions always do */
+int executeDecoded(const Instruction *instruction, const char *name1, const char *name2, 
+                   const int32_t *operands, const char *text);
+
+/* EFFECT: Executes the instructions of _program_ in order, stopping at the first instruction that fails.
+Blocks compiled to native code run natively, other instructions flagged INS_UNCHECKED run on the 
+unchecked fast path, and all others through the functions declared in functions.h, so errors are 
+reported exactly as when interpreting line by line. On a sparse memory (see memory.h), which may run 
+out of pages on any write, every instruction runs through the functions declared in functions.h. The 
+line of the instruction that failed is stored in _program_->errorLine
+OUTPUT: 0 upon successful execution of the function; 1 if an instruction failed;
+2 if allocating memory failed */
+int executeProgram(Program *program);
+
+/* EFFECT: Executes _program_ like executeProgram(), but without native code and running independent 
+instructions in parallel on _pool_ (see pool.h). Consecutive instructions that are proven safe and neither 
+print nor allocate or free arrays form windows, in which every instruction only waits for the previous 
+instructions using one of its arrays. All other instructions are barriers, executed in order on the 
+calling thread, so output and the first error are exactly as when executing in order. A sparse memory
+(see memory.h) is executed in order by executeProgram()
+OUTPUT: 0 upon successful execution of the function; 1 if an instruction failed;
+2 if allocating memory failed */
+int executeProgramParallel(Program *program, struct Pool *pool);
+
+/* EFFECT: Executes _program_ like executeProgram(), but without native code, timing every instruction
+and accumulating the counts and times in _profile_ (see profile.h). A separate loop, so that 
+executeProgram() pays nothing for profiling
+OUTPUT: 0 upon successful execution of the function; 1 if an instruction failed;
+2 if allocating memory failed */
+int executeProgramProfiled(Program *program, struct Profile *profile);
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+
+int ringInit(Ring *ring, size_t capacity, size_t elementSize)
+{
+    ring->slots = malloc(capacity * elementSize);
+    if (!ring->slots)
+    {
+        return 1;
+    }
+
+    ring->elementSize = elementSize;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return 0;
+}
+
+
+void ringFree(Ring *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+
+int ringPush(Ring *ring, const void *element)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask)
+    {
+        return 1;
+    }
+
+    memcpy(ring->slots + (head & ring->mask) * ring->elementSize, element, ring->elementSize);
+
+    // Publish the element only once it is written
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return 0;
+}
+
+
+int ringPop(Ring *ring, void *element)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head)
+    {
+        return 1;
+    }
+
+    memcpy(element, ring->slots + (tail & ring->mask) * ring->elementSize, ring->elementSize);
+
+    // Hand the slot back to the producer only once it is read
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return 0;
+}
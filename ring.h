@@ -0,0 +1,34 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* Bounded lock-free queue of fixed-size elements between exactly one producer thread and one consumer 
+thread. The producer only writes _head_ and the consumer only writes _tail_, each on its own cache line */
+typedef struct Ring
+{
+    unsigned char *slots;
+    size_t elementSize;
+    size_t mask;                        // capacity - 1, the capacity being a power of two
+    _Alignas(64) atomic_size_t head;    // number of elements pushed so far
+    _Alignas(64) atomic_size_t tail;    // number of elements popped so far
+} Ring;
+
+/* EFFECT: Initializes _ring_ for _capacity_ elements of _elementSize_ bytes; _capacity_ must be a power 
+of two
+OUTPUT: 0 upon successful execution of the function; 1 if allocating memory failed */
+int ringInit(Ring *ring, size_t capacity, size_t elementSize);
+
+/* EFFECT: Frees the memory allocated for _ring_ */
+void ringFree(Ring *ring);
+
+/* EFFECT: Copies _element_ to the end of _ring_. Only called by the producer
+OUTPUT: 0 upon successful execution of the function; 1 if _ring_ is full */
+int ringPush(Ring *ring, const void *element);
+
+/* EFFECT: Copies the first element of _ring_ to _element_ and removes it. Only called by the consumer
+OUTPUT: 0 upon successful execution of the function; 1 if _ring_ is empty */
+int ringPop(Ring *ring, void *element);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "interpreter.h"
+#include "output.h"
+#include "server.h"
+
+/* State shared by the workers of the server */
+typedef struct Server
+{
+    int socket;
+    size_t maxProgram;      // size limit of the programs in bytes
+    int (*runBuffer)(const char *data, size_t size);
+} Server;
+
+// Time a worker waits before accepting again when accepting failed for lack of resources
+#define ACCEPT_BACKOFF_NS 100000000
+
+// Local functions
+int sendAll(int fd, const void *data, size_t size);
+int sendFrame(int fd, char type, const void *data, size_t size);
+int receiveProgram(int fd, size_t limit, char **text, size_t *size);
+void serveConnection(Server *server, int fd);
+void *serverWorker(void *argument);
+
+int sendAll(int fd, const void *data, size_t size)
+{
+    /* Local function
+    EFFECT: Sends the _size_ bytes at _data_ over _fd_
+    OUTPUT: 0 upon successful execution of the function; 1 if the connection failed */
+
+    const char *bytes = data;
+    while (size)
+    {
+        ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return 1;
+        }
+        bytes += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+
+int sendFrame(int fd, char type, const void *data, size_t size)
+{
+    /* Local function
+    EFFECT: Sends a frame of type _type_ with the _size_ bytes at _data_ as payload over _fd_
+    OUTPUT: 0 upon successful execution of the function; 1 if the connection failed or the payload does 
+    not fit in a frame */
+
+    if (size > UINT32_MAX)
+    {
+        return 1;
+    }
+
+    unsigned char header[5];
+    uint32_t length = htonl((uint32_t) size);
+
+    header[0] = (unsigned char) type;
+    memcpy(header + 1, &length, sizeof(length));
+
+    return sendAll(fd, header, sizeof(header)) || (size && sendAll(fd, data, size));
+}
+
+
+int receiveProgram(int fd, size_t limit, char **text, size_t *size)
+{
+    /* Local function
+    EFFECT: Receives the text of a program of at most _limit_ bytes from _fd_ until the client shuts 
+    down its writing side, and stores it in _text_ and its length in _size_
+    OUTPUT: 0 upon successful execution of the function; 1 if receiving or allocating memory failed; 
+    2 if the program is larger than _limit_ */
+
+    // One byte more than the limit tells a program of exactly _limit_ bytes from a larger one
+    size_t capacity = limit < 65536 ? limit + 1 : 65536;
+    *text = malloc(capacity);
+    *size = 0;
+
+    while (*text)
+    {
+        if (*size == capacity)
+        {
+            if (*size > limit)
+            {
+                free(*text);
+                *text = NULL;
+                return 2;
+            }
+
+            size_t grown = capacity > limit / 2 ? limit + 1 : 2 * capacity;
+            char *larger = realloc(*text, grown);
+            if (!larger)
+            {
+                break;
+            }
+            *text = larger;
+            capacity = grown;
+        }
+
+        ssize_t n = recv(fd, *text + *size, capacity - *size, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            break;
+        }
+        if (n == 0)
+        {
+            return 0;
+        }
+        *size += n;
+    }
+
+    free(*text);
+    *text = NULL;
+    return 1;
+}
+
+
+void serveConnection(Server *server, int fd)
+{
+    /* Local function
+    EFFECT: Runs the program received over _fd_ and sends back its output, error messages, and exit 
+    status */
+
+    char *out = NULL;
+    char *err = NULL;
+    size_t outSize = 0;
+    size_t errSize = 0;
+    int32_t status = 1;
+
+    size_t size;
+    char *text;
+    int received = receiveProgram(fd, server->maxProgram, &text, &size);
+    FILE *outStream = open_memstream(&out, &outSize);
+    FILE *errStream = open_memstream(&err, &errSize);
+
+    if (text && outStream && errStream)
+    {
+        setStreams(outStream, errStream);
+        status = server->runBuffer(text, size) ? 1 : 0;
+
+        // Leave a clean context for the next connection
+        if (resetProgram())
+        {
+            status = 1;
+        }
+        setStreams(NULL, NULL);
+    }
+    else if (errStream && received == 2)
+    {
+        fprintf(errStream, "Error: the program is larger than %zu bytes\n", server->maxProgram);
+    }
+    else if (errStream)
+    {
+        fprintf(errStream, "Error: receiving the program failed\n");
+    }
+
+    if (outStream)
+    {
+        fclose(outStream);
+    }
+    if (errStream)
+    {
+        fclose(errStream);
+    }
+
+    uint32_t code = htonl((uint32_t) status);
+    if (!sendFrame(fd, FRAME_OUTPUT, out, outSize) && !sendFrame(fd, FRAME_ERROR, err, errSize))
+    {
+        sendFrame(fd, FRAME_STATUS, &code, sizeof(code));
+    }
+
+    free(text);
+    free(out);
+    free(err);
+}
+
+
+void *serverWorker(void *argument)
+{
+    /* Local function
+    EFFECT: Accepts and serves connections on the socket of the server _argument_ forever */
+
+    Server *server = argument;
+
+    if (initializeProgram())
+    {
+        return NULL;
+    }
+
+    for (;;)
+    {
+        int fd = accept(server->socket, NULL, NULL);
+        if (fd < 0)
+        {
+            // Out of descriptors or buffers, accepting fails until connections close; retrying at once
+            // would only spin
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                struct timespec backoff = { 0, ACCEPT_BACKOFF_NS };
+                nanosleep(&backoff, NULL);
+            }
+            continue;
+        }
+
+        serveConnection(server, fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+
+int runServer(const char *path, int workers, size_t maxProgram, int (*runBuffer)(const char *data, size_t size))
+{
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Error: socket path %s is too long\n", path);
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    // Only a socket left behind by an earlier server may be replaced
+    struct stat info;
+    if (!lstat(path, &info) && !S_ISSOCK(info.st_mode))
+    {
+        fprintf(stderr, "Error: %s exists and is not a socket\n", path);
+        return 1;
+    }
+
+    Server server;
+    server.maxProgram = maxProgram;
+    server.runBuffer = runBuffer;
+    server.socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.socket < 0)
+    {
+        fprintf(stderr, "Error: creating the socket failed\n");
+        return 1;
+    }
+
+    unlink(path);
+    if (bind(server.socket, (struct sockaddr *) &address, sizeof(address)) || listen(server.socket, SOMAXCONN))
+    {
+        fprintf(stderr, "Error: listening on %s failed\n", path);
+        close(server.socket);
+        return 1;
+    }
+
+    // Clients that disconnect early must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+
+    if (workers < 1)
+    {
+        workers = 1;
+    }
+
+    // The calling thread serves connections as well
+    for (int i = 1; i < workers; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serverWorker, &server))
+        {
+            fprintf(stderr, "Error: starting the server workers failed\n");
+            close(server.socket);
+            return 1;
+        }
+        pthread_detach(thread);
+    }
+
+    serverWorker(&server);
+
+    fprintf(stderr, "Error: initializing the server failed\n");
+    close(server.socket);
+    return 1;
+}
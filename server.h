@@ -0,0 +1,30 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Protocol between the server and its clients over a Unix domain socket. A client sends the text of one
+program and shuts down its writing side. The server answers with frames of a type byte, a payload length
+as 32-bit unsigned integer in network byte order, and the payload:
+ 'O' - output of the program
+ 'E' - error messages of the program
+ 'X' - exit status as 32-bit integer in network byte order: 0 if the program ran successfully, 1 otherwise
+The exit status frame is always the last one, after which the server closes the connection */
+#define FRAME_OUTPUT 'O'
+#define FRAME_ERROR 'E'
+#define FRAME_STATUS 'X'
+
+// Size limit of a program sent to the server unless one is given
+#define SERVER_DEFAULT_MAX_PROGRAM (64 * 1024 * 1024)
+
+/* EFFECT: Listens on the Unix domain socket at _path_ (replacing a stale socket, but no other file) and 
+serves programs until the process is terminated. _workers_ threads accept connections, each with its own 
+interpreter context that is initialized once and reset after every program. Programs larger than 
+_maxProgram_ bytes are not run; the client gets an error message and exit status 1 instead. _runBuffer_ 
+runs the program held in a buffer in the calling thread's context
+OUTPUT: 1 if _path_ exists and is not a socket, or creating the socket or starting the workers failed; 
+does not return otherwise */
+int runServer(const char *path, int workers, size_t maxProgram, int (*runBuffer)(const char *data, size_t size));
+
+#endif